@@ -0,0 +1,781 @@
+// bench.cpp - benchmark json and bson
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <thread>
+#include "json.h"
+#include "bson.h"
+
+// keep results alive
+volatile double sink;
+
+// seconds taken by one call of f
+template<class F>
+inline double seconds(F f)
+{
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	f();
+
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+inline void report(const char* name, size_t n, double s)
+{
+	printf("%-36s %10.2f ms %8.2f ns/op\n", name, 1e3*s, 1e9*s/n);
+}
+
+void bench_push_back(size_t n)
+{
+	// what push_back used to do
+	report("array realloc per element", n, seconds([n]() {
+		json::element* e = 0;
+		for (size_t i = 0; i < n; ++i) {
+			e = static_cast<json::element*>(realloc(e, (i + 1)*sizeof(json::element)));
+			e[i].type = JSON_NUMBER;
+			e[i].data.number = static_cast<double>(i);
+		}
+		sink = e[n - 1].data.number;
+		free(e);
+	}));
+
+	report("array push_back", n, seconds([n]() {
+		json::value v;
+		for (size_t i = 0; i < n; ++i)
+			v.push_back(json::value(static_cast<double>(i)));
+		sink = v.type == JSON_ARRAY ? v[n - 1].data.number : 0;
+	}));
+
+	report("array reserve + push_back", n, seconds([n]() {
+		json::value v;
+		v.reserve(n);
+		for (size_t i = 0; i < n; ++i)
+			v.push_back(json::value(static_cast<double>(i)));
+		sink = v[n - 1].data.number;
+	}));
+}
+
+template<class M>
+double lookup(const M& m, const std::vector<std::string>& keys, size_t rounds)
+{
+	return seconds([&]() {
+		double sum = 0;
+		for (size_t r = 0; r < rounds; ++r)
+			for (size_t i = 0; i < keys.size(); ++i)
+				sum += static_cast<double>(m.find(keys[i])->second.data.int64);
+		sink = sum;
+	});
+}
+
+// parse and lookup on objects with 10 to 10,000 members
+void bench_object(void)
+{
+#ifdef JSON_FLAT_OBJECT
+	printf("json::object is flat_map\n");
+#else
+	printf("json::object is std::map\n");
+#endif
+	for (size_t n = 10; n <= 10000; n *= 10) {
+		std::vector<std::string> keys;
+		std::string doc = "{";
+		for (size_t i = 0; i < n; ++i) {
+			keys.push_back("key" + std::to_string(i*7919 % n));
+			doc += (i ? ",\"" : "\"") + keys.back() + "\":" + std::to_string(i);
+		}
+		doc += "}";
+
+		size_t rounds = 1000000/n;
+		char name[64];
+
+		sprintf(name, "object parse %zu keys", n);
+		report(name, rounds*n, seconds([&]() {
+			for (size_t r = 0; r < rounds; ++r)
+				sink = static_cast<double>(json::parse::read_object(doc.data(), doc.size()).size());
+		}));
+
+		json::object o = json::parse::read_object(doc.data(), doc.size());
+		std::map<std::string, json::value> m(o.begin(), o.end());
+		json::flat_map<std::string, json::value> f(o.begin(), o.end());
+
+		sprintf(name, "std::map lookup %zu keys", n);
+		report(name, rounds*n, lookup(m, keys, rounds));
+		sprintf(name, "flat_map lookup %zu keys", n);
+		report(name, rounds*n, lookup(f, keys, rounds));
+	}
+}
+
+// prices with two decimals and random doubles, parsed and printed
+void bench_numbers(size_t n)
+{
+	std::string doc = "[";
+	uint64_t x = 88172645463325252ull;
+	for (size_t i = 0; i < n; ++i) {
+		x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+		char buf[32];
+		if (i % 2)
+			sprintf(buf, "%.2f", (x % 10000000)/100.);
+		else
+			sprintf(buf, "%.17g", static_cast<double>(x % 1000000007)/(1 + x % 997));
+		doc += (i ? "," : "") + std::string(buf);
+	}
+	doc += "]";
+
+	json::value v;
+	report("number parse strtod", n, seconds([&]() {
+		double sum = 0;
+		const char* s = doc.data() + 1;
+		for (size_t i = 0; i < n; ++i) {
+			char* e;
+			sum += strtod(s, &e);
+			s = e + 1;
+		}
+		sink = sum;
+	}));
+	report("number parse", n, seconds([&]() {
+		v = json::parse::read_value(doc.data(), doc.size());
+		sink = v[n - 1].data.number;
+	}));
+
+	report("number print ostream", n, seconds([&]() {
+		std::ostringstream os;
+		os.precision(17);
+		for (size_t i = 0; i < n; ++i)
+			os << v[i].data.number << ',';
+		sink = static_cast<double>(os.str().size());
+	}));
+	report("number print", n, seconds([&]() {
+		std::ostringstream os;
+		os << v;
+		sink = static_cast<double>(os.str().size());
+	}));
+}
+
+// encode a numeric array, array index keys used to be std::to_string
+void bench_bson_array(size_t n)
+{
+	json::value v;
+	v.reserve(n);
+	for (size_t i = 0; i < n; ++i)
+		v.push_back(json::value(static_cast<double>(i)));
+	bson::sink s(bson::size(v.data.array) + 16);
+	bson::write("a", v.data.array, s); // touch the pages
+
+	report("bson array keys with std::to_string", n, seconds([&]() {
+		s.clear();
+		for (size_t i = 0; i < n; ++i)
+			bson::write(std::to_string(i).c_str(), v[i], s);
+		sink = static_cast<double>(s.size());
+	}));
+
+	report("bson array encode", n, seconds([&]() {
+		s.clear();
+		bson::write("a", v.data.array, s);
+		sink = static_cast<double>(s.size());
+	}));
+}
+
+// the last field of a document of 50 members
+void bench_bson_find(size_t n)
+{
+	json::object o;
+	for (int i = 0; i < 49; ++i)
+		o["field" + std::to_string(i)] = json::value("some string value");
+	o["zz"] = json::value(1.5);
+	std::vector<char> doc = bson::encode(o);
+
+	report("bson read until found", n, seconds([&]() {
+		for (size_t r = 0; r < n; ++r) {
+			const char* t = &doc[0] + 4;
+			json::pair kv;
+			do
+				kv = bson::read(t);
+			while (kv.first != "zz");
+			sink = kv.second.data.number;
+		}
+	}));
+
+	report("bson find", n, seconds([&]() {
+		for (size_t r = 0; r < n; ++r)
+			sink = bson::find(&doc[0], "zz").number();
+	}));
+
+	bson::document d(&doc[0]);
+	bson::path_index ix(d);
+	report("bson path_index find", n, seconds([&]() {
+		for (size_t r = 0; r < n; ++r)
+			sink = ix.find("zz").number();
+	}));
+}
+
+void bench_write(size_t n)
+{
+	json::value v;
+	v.reserve(n);
+	for (size_t i = 0; i < n; ++i) {
+		json::object o;
+		o["id"] = json::value(static_cast<double>(i));
+		o["name"] = json::value("a fairly ordinary string value");
+		o["text"] = json::value("with \"quotes\" and a\ttab");
+		o["ok"] = json::value(i % 2 == 0);
+		v.push_back(json::value(o));
+	}
+
+	size_t bytes = 0;
+	double s = seconds([&]() {
+		std::ostringstream os;
+		for (size_t i = 0; i < n; ++i) {
+			const json::object& o = *v[i].data.object;
+			os << '{';
+			for (json::object::const_iterator j = o.begin(); j != o.end(); ++j) {
+				const json::value& e = j->second;
+				os << (j == o.begin() ? "" : ",") << '"' << j->first << "\":";
+				if (e.type == JSON_STRING)
+					os << '"' << std::string(e.str().data, e.str().size) << '"';
+				else if (e.type == JSON_NUMBER)
+					os << e.data.number;
+				else
+					os << (e.type == JSON_TRUE ? "true" : "false");
+			}
+			os << '}';
+		}
+		bytes = os.str().size();
+	});
+	report("write ostream (unescaped)", n, s);
+	printf("%-36s %10.2f MB/s\n", "", bytes/s/1e6);
+
+	s = seconds([&]() {
+		json::writer w;
+		w.value(v);
+		bytes = w.size();
+	});
+	report("write", n, s);
+	printf("%-36s %10.2f MB/s\n", "", bytes/s/1e6);
+	s = seconds([&]() {
+		json::writer w(true);
+		w.value(v);
+		bytes = w.size();
+	});
+	report("write pretty", n, s);
+	printf("%-36s %10.2f MB/s\n", "", bytes/s/1e6);
+}
+
+struct tick {
+	std::string symbol;
+	int64_t time;
+	double bid;
+	double ask;
+	int32_t size;
+	JSON_FIELDS(symbol, time, bid, ask, size)
+};
+
+void bench_fields(size_t n)
+{
+	tick t = { "EURUSD", 1700000000000ll, 1.08523, 1.08527, 1000000 };
+	std::string text = json::to_json(t);
+
+	report("struct from json tree", n, seconds([&]() {
+		double sum = 0;
+		for (size_t i = 0; i < n; ++i) {
+			json::object o = json::parse::read_object(text.data(), text.size());
+			tick r;
+			r.symbol.assign(o["symbol"].str().data, o["symbol"].str().size);
+			r.time = o["time"].data.int64;
+			r.bid = o["bid"].data.number;
+			r.ask = o["ask"].data.number;
+			r.size = static_cast<int32_t>(o["size"].data.int64);
+			sum += r.bid;
+		}
+		sink = sum;
+	}));
+	report("struct from json", n, seconds([&]() {
+		double sum = 0;
+		for (size_t i = 0; i < n; ++i) {
+			tick r;
+			json::from_json(text.data(), text.size(), r);
+			sum += r.bid;
+		}
+		sink = sum;
+	}));
+
+	bson::sink b;
+	bson::encode(t, b);
+	report("struct from bson tree", n, seconds([&]() {
+		double sum = 0;
+		for (size_t i = 0; i < n; ++i) {
+			json::object o = bson::decode(b.data(), b.size());
+			sum += o["bid"].data.number;
+		}
+		sink = sum;
+	}));
+	report("struct from bson", n, seconds([&]() {
+		double sum = 0;
+		for (size_t i = 0; i < n; ++i) {
+			tick r;
+			bson::decode(bson::document(b.data(), b.size()), r);
+			sum += r.bid;
+		}
+		sink = sum;
+	}));
+	report("struct to bson", n, seconds([&]() {
+		bson::sink s;
+		for (size_t i = 0; i < n; ++i) {
+			s.clear();
+			bson::encode(t, s);
+		}
+		sink = static_cast<double>(s.size());
+	}));
+}
+
+void bench_strings(size_t n)
+{
+	// the shape of a typical API response, mostly short strings
+	std::string doc = "[";
+	for (size_t i = 0; i < 100; ++i) {
+		char buf[256];
+		sprintf(buf, "%s{\"id\":%u,\"status\":\"%s\",\"type\":\"user\",\"name\":\"User %u\","
+			"\"email\":\"user%u@example.com\",\"tags\":[\"a\",\"beta\"],\"active\":true}",
+			i ? "," : "", unsigned(i), i % 7 ? "ok" : "pending", unsigned(i), unsigned(i));
+		doc += buf;
+	}
+	doc += "]";
+
+	json::alloc_scope a;
+	report("parse api response", n, seconds([&]() {
+		for (size_t i = 0; i < n; ++i) {
+			json::value v = json::parse::read_value(doc.data(), doc.size());
+			sink = static_cast<double>(v.data.array.size);
+		}
+	}));
+	printf("%-36s %10.2f allocs/doc\n", "", double(a.stats().allocations)/n);
+}
+
+void bench_ingest(size_t n)
+{
+	// keys holding arrays, which the istream parser handles
+	std::string doc = "{";
+	for (size_t i = 0; i < 200; ++i) {
+		char buf[128];
+		sprintf(buf, "%s\"key%u\":[%u,\"a string of moderate length %u\",[true,\"nested value here\",%u.5]]",
+			i ? "," : "", unsigned(i), unsigned(i), unsigned(i), unsigned(i));
+		doc += buf;
+	}
+	doc += "}";
+
+	report("istream read_object", n, seconds([&]() {
+		for (size_t i = 0; i < n; ++i) {
+			std::istringstream is(doc);
+			json::object o = json::parse::read_object(is);
+			sink = static_cast<double>(o.size());
+		}
+	}));
+
+	std::vector<char> b = bson::encode(json::parse::read_object(doc.data(), doc.size()));
+	report("bson read", n, seconds([&]() {
+		for (size_t i = 0; i < n; ++i) {
+			json::object o;
+			for (const char* p = &b[4]; *p; )
+				o.insert(bson::read(p));
+			sink = static_cast<double>(o.size());
+		}
+	}));
+}
+
+void bench_ndjson(size_t n)
+{
+	std::string buf;
+	for (size_t i = 0; i < n; ++i) {
+		char line[256];
+		sprintf(line, "{\"id\":%u,\"ts\":%u.25,\"user\":\"user%u\",\"tags\":[\"a\",\"b\"],\"ok\":true,\"msg\":\"a log line of ordinary length\"}\n",
+			unsigned(i), unsigned(i), unsigned(i % 1000));
+		buf += line;
+	}
+
+	unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned t = 1; ; t = std::min(2*t, cores)) {
+		json::ndjson nd(t);
+		for (int ordered = 1; ordered >= 0; --ordered) {
+			std::atomic<size_t> docs(0);
+			double s = seconds([&]() {
+				nd.read(buf.data(), buf.size(), [&](const json::value& v, size_t) { docs += v.type == JSON_OBJECT; }, ordered != 0);
+			});
+			char name[64];
+			sprintf(name, "ndjson %u threads%s", t, ordered ? "" : " unordered");
+			report(name, n, s);
+			printf("%-36s %10.2f MB/s %8.0f docs/ms\n", "", buf.size()/s/1e6, docs/s/1e3);
+		}
+		if (t == cores)
+			break;
+	}
+}
+
+void bench_scanner(size_t n)
+{
+	std::string dump;
+	for (size_t i = 0; i < n; ++i) {
+		json::object o;
+		o["_id"] = json::value(static_cast<double>(i));
+		o["user"] = json::value("someone");
+		o["amount"] = json::value(i*0.25);
+		o["note"] = json::value("an archived record of typical size");
+		std::vector<char> d = bson::encode(o);
+		dump.append(d.begin(), d.end());
+	}
+
+	bson::scanner s(dump.data(), dump.size());
+	unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned t = 1; ; t = std::min(2*t, cores)) {
+		std::atomic<size_t> docs(0);
+		double sec = seconds([&]() {
+			s.each([&](const bson::document& d, size_t) { docs += d["amount"].type == BSON_DOUBLE; }, t);
+		});
+		char name[64];
+		sprintf(name, "bson scan %u threads", t);
+		report(name, n, sec);
+		printf("%-36s %10.2f MB/s %8.0f docs/ms\n", "", dump.size()/sec/1e6, docs/sec/1e3);
+		if (t == cores)
+			break;
+	}
+	report("bson decode each", n, seconds([&]() {
+		double sum = 0;
+		for (bson::scanner::iterator i = s.begin(); i != s.end(); ++i)
+			sum += bson::decode(*i)["amount"].data.number;
+		sink = sum;
+	}));
+}
+
+//
+// corpora
+//
+
+// documents generated from a fixed seed, so runs can be compared
+struct corpus {
+	explicit corpus(const char* name)
+		: name(name), bytes(0)
+	{ }
+
+	const char* name;
+	std::vector<std::string> docs;
+	size_t bytes;
+	std::vector<json::value> values;
+	std::vector<std::vector<char> > bson;
+};
+
+struct xorshift {
+	uint64_t x;
+
+	explicit xorshift(uint64_t seed) : x(seed) { }
+	uint64_t operator()()
+	{
+		x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+
+		return x;
+	}
+	size_t operator()(size_t n) { return (*this)() % n; }
+};
+
+inline std::string words(xorshift& r, size_t n)
+{
+	static const char* w[] = { "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "json", "bson", "parse", "fast", "data" };
+	std::string s;
+
+	for (size_t i = 0; i < n; ++i)
+		s += (i ? " " : "") + std::string(w[r(sizeof(w)/sizeof(*w))]);
+
+	return s;
+}
+
+// no nulls anywhere, they never compare equal
+corpus twitter(size_t n)
+{
+	static const char* lang[] = { "en", "ja", "es", "pt" };
+	corpus c("twitter");
+	xorshift r(1);
+
+	for (size_t i = 0; i < n; ++i) {
+		char buf[1024];
+		std::string text = words(r, 5 + r(15));
+		sprintf(buf, "{\"created_at\":\"Mon Sep 24 03:35:%02u +0000 2012\",\"id\":%llu,\"text\":\"%s\","
+			"\"user\":{\"id\":%u,\"name\":\"%s\",\"screen_name\":\"user_%u\",\"followers_count\":%u,\"verified\":%s,\"lang\":\"%s\"},"
+			"\"entities\":{\"hashtags\":[{\"text\":\"%s\",\"indices\":[%u,%u]}],\"urls\":[],\"user_mentions\":[]},"
+			"\"retweet_count\":%u,\"favorited\":false,\"truncated\":false,\"lang\":\"%s\"}",
+			unsigned(r(60)), static_cast<unsigned long long>(r() >> 8), text.c_str(),
+			unsigned(r(1u << 30)), words(r, 2).c_str(), unsigned(r(100000)), unsigned(r(1000000)), r(10) ? "false" : "true", lang[r(4)],
+			words(r, 1).c_str(), unsigned(r(50)), unsigned(50 + r(50)),
+			unsigned(r(1000)), lang[r(4)]);
+		c.docs.push_back(buf);
+	}
+
+	return c;
+}
+corpus numeric(size_t n)
+{
+	corpus c("numeric");
+	xorshift r(2);
+
+	for (size_t i = 0; i < n; ++i) {
+		std::string d = "{\"points\":[";
+		for (size_t j = 0; j < 50; ++j) {
+			char buf[128];
+			sprintf(buf, "%s[%.6f,%.6f,%.3f]", j ? "," : "", r(1000000)/1e4 - 50, r(1000000)/1e4 - 50, r(100000)/1e2);
+			d += buf;
+		}
+		d += "],\"ids\":[";
+		for (size_t j = 0; j < 50; ++j)
+			d += (j ? "," : "") + std::to_string(r(1ull << 40));
+		d += "]}";
+		c.docs.push_back(d);
+	}
+
+	return c;
+}
+corpus nested(size_t n)
+{
+	corpus c("nested");
+	xorshift r(3);
+
+	for (size_t i = 0; i < n; ++i) {
+		size_t depth = 40 + r(40);
+		std::string d;
+		for (size_t j = 0; j < depth; ++j)
+			d += j % 2 ? "[" : "{\"a\":";
+		d += std::to_string(r(1000));
+		for (size_t j = depth; j-- > 0; )
+			d += j % 2 ? "]" : "}";
+		c.docs.push_back(d);
+	}
+
+	return c;
+}
+corpus strings(size_t n)
+{
+	corpus c("strings");
+	xorshift r(4);
+
+	for (size_t i = 0; i < n; ++i) {
+		std::string d = "{";
+		for (size_t j = 0; j < 20; ++j) {
+			std::string s = words(r, 10 + r(40));
+			if (r(4) == 0)
+				s += " \\\"quoted\\\"\\n\\u00e9";
+			d += (j ? ",\"k" : "\"k") + std::to_string(j) + "\":\"" + s + "\"";
+		}
+		d += "}";
+		c.docs.push_back(d);
+	}
+
+	return c;
+}
+
+// f(i) on each document of c, repeated for at least a fifth of a second
+template<class F>
+void measure(const char* what, const corpus& c, F f)
+{
+	size_t rounds = 0;
+	json::alloc_scope all;
+	double s = 0;
+
+	while (s < 0.2) {
+		s += seconds([&]() {
+			for (size_t i = 0; i < c.docs.size(); ++i)
+				f(i);
+		});
+		++rounds;
+	}
+
+	double docs = static_cast<double>(rounds*c.docs.size());
+	double allocs = all.stats().allocations/docs;
+
+	// most value bytes held at once, per document
+	double peak = 0;
+	for (size_t i = 0; i < c.docs.size(); ++i) {
+		json::alloc_scope one;
+		f(i);
+		peak += static_cast<double>(one.stats().peak);
+	}
+	peak /= c.docs.size();
+
+	printf("%-8s %-20s %10.1f MB/s %11.0f docs/s %8.1f allocs/doc %9.0f peak/doc\n",
+		c.name, what, rounds*c.bytes/s/1e6, docs/s, allocs, peak);
+}
+
+void bench_corpus(corpus c)
+{
+	c.bytes = 0;
+	for (size_t i = 0; i < c.docs.size(); ++i) {
+		c.bytes += c.docs[i].size();
+		c.values.push_back(json::parse::read_value(c.docs[i].data(), c.docs[i].size()));
+		c.bson.push_back(bson::encode(*c.values.back().data.object));
+	}
+
+	measure("parse", c, [&](size_t i) {
+		json::value v = json::parse::read_value(c.docs[i].data(), c.docs[i].size());
+		sink = v.type;
+	});
+	measure("parse arena", c, [&](size_t i) {
+		json::arena a;
+		json::value v = json::parse::read_value(c.docs[i].data(), c.docs[i].size(), a);
+		sink = v.type;
+	});
+	// owned values and map nodes from a memory that never frees
+	measure("parse memory", c, [&](size_t i) {
+		json::arena a;
+		json::value v = json::parse::read_value(c.docs[i].data(), c.docs[i].size(), static_cast<json::memory&>(a));
+		sink = v.type;
+	});
+	measure("operator>>", c, [&](size_t i) {
+		std::istringstream is(c.docs[i]);
+		json::object o;
+		is >> o;
+		sink = static_cast<double>(o.size());
+	});
+	measure("operator<<", c, [&](size_t i) {
+		std::ostringstream os;
+		os << c.values[i];
+		sink = static_cast<double>(os.tellp());
+	});
+	json::writer w;
+	measure("writer", c, [&](size_t i) {
+		w.clear();
+		w.value(c.values[i]);
+		sink = static_cast<double>(w.size());
+	});
+	bson::sink s;
+	measure("bson encode", c, [&](size_t i) {
+		s.clear();
+		bson::encode(*c.values[i].data.object, s);
+		sink = static_cast<double>(s.size());
+	});
+	measure("bson decode", c, [&](size_t i) {
+		json::object o = bson::decode(&c.bson[i][0], c.bson[i].size());
+		sink = static_cast<double>(o.size());
+	});
+	measure("bson read", c, [&](size_t i) {
+		json::object o;
+		for (const char* p = &c.bson[i][4]; *p; )
+			o.insert(bson::read(p));
+		sink = static_cast<double>(o.size());
+	});
+	measure("value copy", c, [&](size_t i) {
+		json::value v(c.values[i]);
+		sink = v.type;
+	});
+	// equal copies, so the whole tree is walked
+	std::vector<json::value> copies(c.values);
+	measure("value compare", c, [&](size_t i) {
+		bool equal = c.values[i] == copies[i];
+		assert (equal);
+		sink = equal;
+	});
+}
+
+// the same paths on every document, compiled once against chained finds
+void bench_path(corpus c)
+{
+	c.bytes = 0;
+	for (size_t i = 0; i < c.docs.size(); ++i) {
+		c.bytes += c.docs[i].size();
+		c.values.push_back(json::parse::read_value(c.docs[i].data(), c.docs[i].size()));
+	}
+
+	json::path name("user.screen_name"), tag("/entities/hashtags/0/text");
+	measure("path", c, [&](size_t i) {
+		const json::value* u = name.find(c.values[i]);
+		const json::value* t = tag.find(c.values[i]);
+		sink = static_cast<double>(u && t);
+	});
+	measure("path by hand", c, [&](size_t i) {
+		const json::object& o = *c.values[i].data.object;
+		const json::value* u = 0;
+		const json::value* t = 0;
+		json::object::const_iterator j = o.find("user");
+		if (j != o.end() && j->second.type == JSON_OBJECT) {
+			json::object::const_iterator k = j->second.data.object->find("screen_name");
+			if (k != j->second.data.object->end())
+				u = &k->second;
+		}
+		j = o.find("entities");
+		if (j != o.end() && j->second.type == JSON_OBJECT) {
+			json::object::const_iterator k = j->second.data.object->find("hashtags");
+			if (k != j->second.data.object->end() && k->second.type == JSON_ARRAY && k->second.data.array.size) {
+				const json::value& h = k->second[0];
+				if (h.type == JSON_OBJECT) {
+					json::object::const_iterator l = h.data.object->find("text");
+					if (l != h.data.object->end())
+						t = &l->second;
+				}
+			}
+		}
+		sink = static_cast<double>(u && t);
+	});
+}
+
+// routing: two fields out of messages of 5 to 50 KB, one of them after
+// the bulk of the message
+void bench_lazy(size_t n)
+{
+	corpus t = twitter(1000), c("messages");
+	xorshift r(3);
+
+	c.bytes = 0;
+	for (size_t i = 0; i < n; ++i) {
+		std::string m = "{\"id\":" + std::to_string(i) + ",\"items\":[";
+		for (size_t j = 0, k = 8 + r(60); j < k; ++j)
+			m += (j ? "," : "") + t.docs[r(t.docs.size())];
+		m += "],\"route\":\"queue-" + std::to_string(i % 7) + "\"}";
+		c.bytes += m.size();
+		c.docs.push_back(m);
+	}
+	printf("%-36s %10.1f KB/message\n", "", c.bytes/1e3/n);
+
+	measure("route parse", c, [&](size_t i) {
+		json::value v = json::parse::read_value(c.docs[i].data(), c.docs[i].size());
+		sink = static_cast<double>((*v.data.object)["id"].type + (*v.data.object)["route"].str().size);
+	});
+	json::parse::document d;
+	measure("route on demand", c, [&](size_t i) {
+		d.read(c.docs[i].data(), c.docs[i].size());
+		json::parse::lazy r = d.root();
+		double id = 0;
+		std::string route;
+		r["id"].get(id);
+		r["route"].get(route);
+		sink = id + route.size();
+	});
+}
+
+int main(int argc, char* argv[])
+{
+	// bench corpus runs the corpora only
+	if (argc > 1 && !strcmp(argv[1], "corpus")) {
+		bench_corpus(twitter(1000));
+		bench_corpus(numeric(200));
+		bench_corpus(nested(1000));
+		bench_corpus(strings(500));
+
+		return 0;
+	}
+	size_t n = argc > 1 ? strtoul(argv[1], 0, 10) : 10000000;
+
+	bench_push_back(n);
+	bench_object();
+	bench_numbers(1000000);
+	bench_bson_array(1000000);
+	bench_bson_find(100000);
+	bench_write(200000);
+	bench_fields(200000);
+	bench_strings(10000);
+	bench_ingest(2000);
+	bench_ndjson(1000000);
+	bench_scanner(1000000);
+
+	bench_corpus(twitter(1000));
+	bench_corpus(numeric(200));
+	bench_corpus(nested(1000));
+	bench_corpus(strings(500));
+	bench_path(twitter(1000));
+	bench_lazy(200);
+
+	return 0;
+}
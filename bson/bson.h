@@ -2,10 +2,13 @@
 #pragma once
 #include <cstdint>
 #include <cstdlib>
+#include <algorithm>
+#include <iterator>
 #include <string>
-#include <io.h>
-#include <string>
+#include <thread>
+#include <vector>
 #include "json.h"
+#include "mapped_file.h"
 
 typedef enum {
 	BSON_EOO = 0,
@@ -55,121 +58,479 @@ namespace bson {
 	// writing objects
 	//
 
-	template<typename T>
-	inline size_t write(const char* key, const T& val, char*&  buf)
+	// Output for the writers. A sink hands out room for a whole element
+	// with reserve and is told how much was used with commit, so the
+	// capacity is checked once per element rather than per byte.
+	// A growable sink reallocates as needed. A sink over a caller's buffer
+	// never writes past it: once an element does not fit, overflow() is
+	// true and nothing more is written. The same happens for an element
+	// bson cannot hold, see fail.
+	class sink {
+		sink(const sink&);
+		sink& operator=(const sink&);
+	public:
+		// growable, owns its storage
+		explicit sink(size_t n = 256)
+			: b(static_cast<char*>(malloc(n))), p(b), e(b + n), l(e), mode(GROW), overflow_(false)
+		{
+			if (!b)
+				throw std::bad_alloc();
+		}
+		// the n bytes at buf, e.g. a pooled network buffer
+		sink(char* buf, size_t n)
+			: b(buf), p(buf), e(buf + n), l(e), mode(FIXED), overflow_(false)
+		{ }
+		~sink()
+		{
+			if (mode == GROW)
+				free(b);
+		}
+
+		// at least n writable bytes at the end, 0 if they do not fit
+		char* reserve(size_t n)
+		{
+			return n <= static_cast<size_t>(e - p) ? p : make_room(n);
+		}
+		// bytes up to q have been written
+		void commit(char* q)
+		{
+			p = q;
+		}
+
+		char* data() { return b; }
+		const char* data() const { return b; }
+		size_t size() const { return p - b; }
+		size_t capacity() const { return l - b; }
+		bool overflow() const { return overflow_; }
+		// position of an earlier write, offsets stay valid when the buffer grows
+		char* at(size_t offset) { return b + offset; }
+		// stop writing, e.g. at a key with an embedded null
+		void fail()
+		{
+			overflow_ = true;
+			// no room left, so reserve turns every later element away
+			e = p;
+		}
+		// start over, keeping the storage
+		void clear()
+		{
+			p = b;
+			e = l;
+			overflow_ = false;
+		}
+
+		// for the raw pointer writers, grows into whatever follows buf
+		struct unchecked_t { };
+		sink(char* buf, unchecked_t)
+			: b(buf), p(buf), e(buf), l(e), mode(UNCHECKED), overflow_(false)
+		{ }
+
+	private:
+		enum mode_t { GROW, FIXED, UNCHECKED };
+		char* b;
+		char* p;
+		char* e; // end of the room for writing, p once writing has stopped
+		char* l; // end of the storage
+		mode_t mode;
+		bool overflow_;
+
+		char* make_room(size_t n)
+		{
+			if (overflow_)
+				return 0;
+
+			switch (mode) {
+			case GROW: {
+				size_t size = p - b, cap = l - b;
+				cap = cap + cap/2 > size + n ? cap + cap/2 : size + n;
+				char* q = static_cast<char*>(realloc(b, cap));
+				if (!q)
+					throw std::bad_alloc();
+				b = q;
+				p = q + size;
+				e = l = q + cap;
+				break;
+			}
+			case UNCHECKED:
+				e = l = p + n;
+				break;
+			default:
+				fail();
+				return 0;
+			}
+
+			return p;
+		}
+	};
+
+	// declared up front so write(key, element) does not pick the template
+	inline size_t write(const char* key, const json::string& val, sink& s);
+	inline size_t write(const char* key, const json::object& val, sink& s);
+	inline size_t write(const char* key, const json::array& val, sink& s);
+	inline size_t write(const char* key, const json::byte& val, sink& s);
+
+	// type and null terminated key followed by room for n bytes,
+	// 0 if the sink is full
+	inline char* write_key(bson_type type, const char* key, size_t n, sink& s)
 	{
-		size_t bytes = 1;
-		*buf++ = bson_enum<T>::type;
+		size_t k = strlen(key) + 1;
+		char* buf = s.reserve(1 + k + n);
 
-		while (*key) {
-			*buf++ = *key++;
-			++bytes;
+		if (buf) {
+			*buf++ = type;
+			memcpy(buf, key, k);
+			buf += k;
 		}
-		*buf++ = *key++; // null terminate key
-		++bytes;
 
-		size_t size = sizeof(val);
-		memcpy(buf, &val, size);
-		buf += size;
-		bytes += size;
+		return buf;
+	}
+	inline void write_int32(int32_t i, char* buf)
+	{
+		memcpy(buf, &i, 4);
+	}
+	template<typename T>
+	inline size_t write(const char* key, const T& val, sink& s)
+	{
+		size_t n = s.size();
+		char* buf = write_key(bson_enum<T>::type, key, sizeof(val), s);
+
+		if (!buf)
+			return 0;
+		memcpy(buf, &val, sizeof(val));
+		s.commit(buf + sizeof(val));
+
+		return s.size() - n;
+	}
+	// int64_t is time_t on some platforms, so no bson_enum
+	inline size_t write_long(const char* key, int64_t val, sink& s)
+	{
+		size_t n = s.size();
+		char* buf = write_key(BSON_LONG, key, 8, s);
+
+		if (!buf)
+			return 0;
+		memcpy(buf, &val, 8);
+		s.commit(buf + 8);
+
+		return s.size() - n;
+	}
+	inline size_t write_null(const char* key, sink& s)
+	{
+		size_t n = s.size();
+		char* buf = write_key(BSON_NULL, key, 0, s);
+
+		if (!buf)
+			return 0;
+		s.commit(buf);
 
-		return bytes;
+		return s.size() - n;
+	}
+	// strings left escaped by a view parse, kept off the element path
+	inline size_t write_escaped(const char* key, const json::string& val, sink& s)
+	{
+		std::string tmp = json::unescape(val);
+
+		return write(key, json::string_(tmp.size(), tmp.data()), s);
 	}
 	// specializations
-	inline size_t write(const char* key, const json::element& val, char*& buf)
+	inline size_t write(const char* key, const json::element& val, sink& s)
 	{
-		return val.type == JSON_NUMBER ? write(key, val.data.number, buf)
-			:  val.type == JSON_STRING ? write(key, val.data.string, buf)
-			:  val.type == JSON_OBJECT ? write(key, val.data.object, buf)
-			:  val.type == JSON_ARRAY ? write(key, val.data.array, buf)
-			:  val.type == JSON_BYTE ? write(key, val.data.byte, buf)
+		if (val.type == JSON_STRING && (val.flags & JSON_ESCAPED))
+			return write_escaped(key, val.data.string, s);
+
+		return val.type == JSON_NUMBER ? write(key, val.data.number, s)
+			:  val.type == JSON_STRING ? write(key, val.str(), s)
+			:  val.type == JSON_OBJECT ? write(key, *val.data.object, s)
+			:  val.type == JSON_ARRAY ? write(key, val.data.array, s)
+			:  val.type == JSON_BYTE ? write(key, val.data.byte, s)
 //	BSON_UNDEFINED = 6,
 //	BSON_OID = 7,
-			:  val.type == JSON_TRUE ? write(key, true, buf)
-			:  val.type == JSON_FALSE ? write(key, false, buf)
-			:  val.type == JSON_DATE ? write(key, val.data.date, buf)
-//???			:  val.type == BSON_NULL = 10,
+			:  val.type == JSON_TRUE ? write(key, true, s)
+			:  val.type == JSON_FALSE ? write(key, false, s)
+			:  val.type == JSON_DATE ? write(key, val.data.date, s)
+			:  val.type == JSON_NULL ? write_null(key, s)
 //	BSON_REGEX = 11,
 //	BSON_CODE = 13,
 //	BSON_SYMBOL = 14,
 //	BSON_CODEWSCOPE = 15,
-			:  val.type == JSON_INT32 ? write(key, val.data.int32, buf)
+			:  val.type == JSON_INT32 ? write(key, val.data.int32, s)
 //	BSON_TIMESTAMP = 17,
-//			:  val.type == JSON_INT64 ? write(key, val.data.int64, buf)
+			:  val.type == JSON_INT64 ? write_long(key, val.data.int64, s)
 			: 0 // no write
 			;
 	}
-	inline size_t write(const char* key, const json::value& val, char*& buf)
+	inline size_t write(const char* key, const json::value& val, sink& s)
 	{
-		return write(key, static_cast<const json::element&>(val), buf);
+		return write(key, static_cast<const json::element&>(val), s);
 	}
 	// none template functions resolved first
-	inline size_t write(const char* key, const json::string& val, char*&  buf)
+	inline size_t write(const char* key, const json::string& val, sink& s)
 	{
-		size_t bytes = 1;
-		*buf++ = BSON_STRING;
-
-		while (*key) {
-			*buf++ = *key++;
-			++bytes;
-		}
-		*buf++ = *key++; // null terminate key
-		++bytes;
+		size_t n = s.size();
+		char* buf = write_key(BSON_STRING, key, 4 + val.size + 1, s);
 
-		*(uint32_t*)buf = val.size + 1;
+		if (!buf)
+			return 0;
+		write_int32(static_cast<int32_t>(val.size + 1), buf);
 		buf += 4;
-		bytes += 4;
-		
 		memcpy(buf, val.data, val.size);
 		buf += val.size;
 		*buf++ = 0;
-		bytes += val.size + 1;
+		s.commit(buf);
 
-		return bytes;
+		return s.size() - n;
 	}
-	inline size_t write(const char* key, const char* val, char*&  buf)
+	inline size_t write(const char* key, const char* val, sink& s)
 	{
-		return write(key, json::string_(strlen(val), val), buf);
+		return write(key, json::string_(strlen(val), val), s);
 	}
-	inline size_t write(const char* key, const json::array& val, char*& buf)
+	// start of an embedded document, its length is patched in by close_document
+	inline bool open_document(sink& s, size_t& start)
 	{
-		size_t bytes = 1;
-		*buf++ = BSON_ARRAY;
+		char* buf = s.reserve(4);
 
-		while (*key) {
-			*buf++ = *key++;
-			++bytes;
-		}
-		*buf++ = *key++; // null terminate key
-		++bytes;
+		if (!buf)
+			return false;
+		start = s.size();
+		s.commit(buf + 4);
+
+		return true;
+	}
+	inline size_t close_document(sink& s, size_t start)
+	{
+		char* buf = s.reserve(1);
 
-		for (long long i = 0; i < val.size; ++i) {
-			bytes += write(std::to_string(i).c_str(), val.element[i], buf);
+		if (!buf)
+			return 0;
+		*buf++ = 0;
+		s.commit(buf);
+		write_int32(static_cast<int32_t>(s.size() - start), s.at(start));
+
+		return s.size() - start;
+	}
+	// embedded document, the length is patched in once the members are written
+	inline size_t write(const json::object& val, sink& s)
+	{
+		size_t start;
+
+		if (!open_document(s, start))
+			return 0;
+		for (json::object::const_iterator i = val.begin(); i != val.end(); ++i) {
+			// keys are null terminated, "\u0000" in one has no encoding
+			if (memchr(i->first.data(), 0, i->first.size())) {
+				s.fail();
+				return 0;
+			}
+			write(i->first.c_str(), i->second, s);
 		}
-		
-		return bytes;
+
+		return close_document(s, start);
 	}
-	inline size_t write(const char* key, const json::byte& val, char*& buf)
+	inline size_t write(const char* key, const json::object& val, sink& s)
 	{
-		size_t bytes = 1;
-		*buf++ = BSON_BINDATA;
+		size_t n = s.size();
+		char* buf = write_key(BSON_OBJECT, key, 0, s);
+
+		if (!buf)
+			return 0;
+		s.commit(buf);
+		write(val, s);
+
+		return s.size() - n;
+	}
+	// decimal key of array element i, buf has room for 21 characters
+	// keys below 1000 come from a table, larger ones are written two digits at a time
+	inline const char* index_key(size_t i, char* buf)
+	{
+		struct table {
+			char key[1000][4];
+			table()
+			{
+				for (int j = 0; j < 1000; ++j) {
+					char* p = key[j];
+					if (j >= 100)
+						*p++ = '0' + j/100;
+					if (j >= 10)
+						*p++ = '0' + j/10%10;
+					*p++ = '0' + j%10;
+					*p = 0;
+				}
+			}
+		};
+		static const table t;
+
+		if (i < 1000)
+			return t.key[i];
 
-		while (*key) {
-			*buf++ = *key++;
-			++bytes;
+		char* p = buf + 20;
+		*p = 0;
+		while (i >= 100) {
+			const char* d = t.key[i%100 + 100] + 1; // "1dd"
+			i /= 100;
+			*--p = d[1];
+			*--p = d[0];
 		}
-		*buf++ = *key++; // null terminate key
-		++bytes;
+		if (i >= 10) {
+			*--p = t.key[i][1];
+			*--p = t.key[i][0];
+		}
+		else {
+			*--p = static_cast<char>('0' + i);
+		}
+
+		return p;
+	}
+	// arrays are documents with keys "0", "1", ...
+	inline size_t write(const char* key, const json::array& val, sink& s)
+	{
+		size_t n = s.size(), start;
+		char* buf = write_key(BSON_ARRAY, key, 0, s);
+
+		if (!buf)
+			return 0;
+		s.commit(buf);
+		if (!open_document(s, start))
+			return 0;
+		char index[21];
+		for (size_t i = 0; i < val.size; ++i)
+			write(index_key(i, index), val.element[i], s);
+
+		close_document(s, start);
+
+		return s.size() - n;
+	}
+	inline size_t write(const char* key, const json::byte& val, sink& s)
+	{
+		size_t n = s.size();
+		char* buf = write_key(BSON_BINDATA, key, 4 + 1 + val.size, s);
 
-		*(uint32_t*)buf = val.size;
+		if (!buf)
+			return 0;
+		write_int32(static_cast<int32_t>(val.size), buf);
 		buf += 4;
-		bytes += 4;
-		
+		*buf++ = BSON_BIN_BINARY;
 		memcpy(buf, val.data, val.size);
 		buf += val.size;
-		bytes += val.size;
+		s.commit(buf);
 
-		return bytes;
+		return s.size() - n;
+	}
+
+	// writing through a raw pointer, the caller makes sure the buffer is big enough
+	template<typename T>
+	inline size_t write(const char* key, const T& val, char*& buf)
+	{
+		sink s(buf, sink::unchecked_t());
+		size_t n = write(key, val, s);
+
+		buf += n;
+
+		return n;
+	}
+#define BSON_WRITE_UNCHECKED(T) \
+	inline size_t write(const char* key, T val, char*& buf) \
+	{ \
+		sink s(buf, sink::unchecked_t()); \
+		size_t n = write(key, val, s); \
+		buf += n; \
+		return n; \
+	}
+	BSON_WRITE_UNCHECKED(const json::string&)
+	BSON_WRITE_UNCHECKED(const json::object&)
+	BSON_WRITE_UNCHECKED(const json::array&)
+	BSON_WRITE_UNCHECKED(const json::byte&)
+	BSON_WRITE_UNCHECKED(const json::element&)
+	BSON_WRITE_UNCHECKED(const char*)
+#undef BSON_WRITE_UNCHECKED
+	inline size_t write(const json::object& val, char*& buf)
+	{
+		sink s(buf, sink::unchecked_t());
+		size_t n = write(val, s);
+
+		buf += n;
+
+		return n;
+	}
+
+	//
+	// encoding documents
+	//
+
+	inline size_t size(const json::object& o);
+	inline size_t size(const json::array& a);
+	inline size_t digits(size_t i)
+	{
+		size_t n = 1;
+
+		while (i >= 10) {
+			i /= 10;
+			++n;
+		}
+
+		return n;
+	}
+	// bytes of an element after its key, 0 if it is not written
+	inline size_t size(const json::element& e)
+	{
+		switch (e.type) {
+		case JSON_NUMBER: return 8;
+		case JSON_STRING:
+			return 4 + 1 + ((e.flags & JSON_ESCAPED) ? json::unescape(e.data.string).size() : e.str().size);
+		case JSON_OBJECT: return size(*e.data.object);
+		case JSON_ARRAY: return size(e.data.array);
+		case JSON_BYTE: return 4 + 1 + e.data.byte.size;
+		case JSON_TRUE: case JSON_FALSE: return 1;
+		case JSON_DATE: return sizeof(time_t);
+		case JSON_NULL: return 0;
+		case JSON_INT32: return 4;
+		case JSON_INT64: return 8;
+		default: return 0;
+		}
+	}
+	// type byte, key and value
+	inline size_t size(size_t key, const json::element& e)
+	{
+		return e.type == JSON_UNDEFINED ? 0 : 1 + key + 1 + size(e);
+	}
+	inline size_t size(const json::object& o)
+	{
+		size_t n = 4 + 1;
+
+		for (json::object::const_iterator i = o.begin(); i != o.end(); ++i)
+			n += size(i->first.size(), i->second);
+
+		return n;
+	}
+	inline size_t size(const json::array& a)
+	{
+		size_t n = 4 + 1;
+
+		for (size_t i = 0; i < a.size; ++i)
+			n += size(digits(i), a.element[i]);
+
+		return n;
+	}
+
+	// length prefixed document, sized up front and written into one buffer,
+	// empty if a key has an embedded null
+	inline std::vector<char> encode(const json::object& o)
+	{
+		std::vector<char> doc(size(o));
+		sink s(&doc[0], doc.size());
+
+		write(o, s);
+		if (s.overflow())
+			doc.clear();
+		ensure (doc.empty() || s.size() == doc.size());
+
+		return doc;
+	}
+	// append a document to s, false if it did not fit or a key has an embedded null
+	inline bool encode(const json::object& o, sink& s)
+	{
+		write(o, s);
+
+		return !s.overflow();
 	}
 
 	//
@@ -190,11 +551,23 @@ namespace bson {
 		return key;
 	}
 	
+	// fields are not aligned
+	inline int32_t read_int32(const char* buf)
+	{
+		int32_t i;
+
+		memcpy(&i, buf, 4);
+
+		return i;
+	}
+
 	// read a T off the string
 	template<typename T>
 	inline T value(const char*& buf)
 	{
-		T t = *(T*)buf;
+		T t;
+
+		memcpy(&t, buf, sizeof(T));
 		buf += sizeof(T);
 
 		return t;
@@ -203,13 +576,25 @@ namespace bson {
 	inline json::string value<json::string>(const char*& buf)
 	{
 		json::string val;
-		val.size = *(int32_t*)buf - 1;
+		val.size = read_int32(buf) - 1;
 		buf += 4;
 		val.data = buf;
 		buf += val.size + 1;
 
 		return val;
 	}
+	// size, subtype and data
+	template<>
+	inline json::byte value<json::byte>(const char*& buf)
+	{
+		json::byte val;
+		val.size = read_int32(buf);
+		buf += 4 + 1;
+		val.data = reinterpret_cast<const uint8_t*>(buf);
+		buf += val.size;
+
+		return val;
+	}
 	// overload template function with same name
 	inline json::element value(bson_type type, const char*& buf)
 	{
@@ -222,19 +607,18 @@ namespace bson {
 			break;
 		case BSON_STRING:
 			e.type = JSON_STRING;
+			e.flags = JSON_BORROWED; // points into buf
 			e.data.string = value<json::string>(buf);
 			break;
+		// embedded documents and arrays are skipped, read and decode build them
 		case BSON_OBJECT:
-			e.type = JSON_OBJECT;
-			e.data.object = value<json::object*>(buf);
-			break;
-		// arrays have the form {'0':item0, '1', item1, ...}
 		case BSON_ARRAY:
-			e.type = JSON_ARRAY;
-			e.data.array.size = 0;
+			e.type = JSON_UNDEFINED;
+			buf += read_int32(buf);
 			break;
 		case BSON_BINDATA:
 			e.type = JSON_BYTE;
+			e.flags = JSON_BORROWED; // points into buf
 			e.data.byte = value<json::byte>(buf);
 			break;
 //	BSON_UNDEFINED = 6,
@@ -270,14 +654,940 @@ namespace bson {
 		return e;
 	}
 
+	//
+	// documents in place
+	//
+
+	// size of the value of type t at p, false if it is malformed or runs past e
+	inline bool value_size(bson_type t, const char* p, const char* e, size_t& n)
+	{
+		size_t left = e - p;
+		int32_t i;
+
+		switch (t) {
+		case BSON_UNDEFINED: case BSON_NULL:
+			n = 0;
+			return true;
+		case BSON_BOOL:
+			n = 1;
+			break;
+		case BSON_INT:
+			n = 4;
+			break;
+		case BSON_DOUBLE: case BSON_DATE: case BSON_TIMESTAMP: case BSON_LONG:
+			n = 8;
+			break;
+		case BSON_OID:
+			n = 12;
+			break;
+		case BSON_STRING: case BSON_CODE: case BSON_SYMBOL: case BSON_DBREF:
+			if (left < 4 || (i = read_int32(p)) < 1)
+				return false;
+			n = 4 + static_cast<size_t>(i) + (t == BSON_DBREF ? 12 : 0);
+			break;
+		case BSON_OBJECT: case BSON_ARRAY: case BSON_CODEWSCOPE:
+			if (left < 4 || (i = read_int32(p)) < 5)
+				return false;
+			n = static_cast<size_t>(i);
+			break;
+		case BSON_BINDATA:
+			if (left < 4 || (i = read_int32(p)) < 0)
+				return false;
+			n = 4 + 1 + static_cast<size_t>(i);
+			break;
+		case BSON_REGEX: { // pattern and options, both null terminated
+			const char* q = static_cast<const char*>(memchr(p, 0, left));
+			q = q ? static_cast<const char*>(memchr(q + 1, 0, e - q - 1)) : 0;
+			if (!q)
+				return false;
+			n = q + 1 - p;
+			break;
+		}
+		default:
+			return false;
+		}
+
+		return n <= left;
+	}
+
+	class document;
+
+	// an element of a document, pointing into its buffer
+	struct field {
+		bson_type type; // BSON_EOO if there is no such field
+		json::string key; // null terminated
+		const char* data; // the value
+		size_t size; // bytes of the value
+
+		operator bool() const
+		{
+			return type != BSON_EOO;
+		}
+
+		double number() const
+		{
+			double d;
+
+			memcpy(&d, data, 8);
+
+			return d;
+		}
+		int32_t int32() const
+		{
+			return read_int32(data);
+		}
+		int64_t int64() const
+		{
+			int64_t i;
+
+			memcpy(&i, data, 8);
+
+			return i;
+		}
+		bool boolean() const
+		{
+			return *data != 0;
+		}
+		time_t date() const
+		{
+			time_t t;
+
+			memcpy(&t, data, sizeof(time_t));
+
+			return t;
+		}
+		// string, code and symbol
+		json::string string() const
+		{
+			return json::string_(size - 4 - 1, data + 4);
+		}
+		json::byte byte() const
+		{
+			return json::byte_(size - 4 - 1, reinterpret_cast<const uint8_t*>(data + 4 + 1));
+		}
+		// embedded document or array
+		inline bson::document document() const;
+		// scalars and borrowed strings and bytes, JSON_UNDEFINED for the rest
+		json::element element() const
+		{
+			json::element e;
+
+			e.type = JSON_UNDEFINED;
+			e.flags = JSON_BORROWED;
+			switch (type) {
+			case BSON_DOUBLE: e.type = JSON_NUMBER; e.data.number = number(); break;
+			case BSON_STRING: e.type = JSON_STRING; e.data.string = string(); break;
+			case BSON_BINDATA: e.type = JSON_BYTE; e.data.byte = byte(); break;
+			case BSON_BOOL: e.type = boolean() ? JSON_TRUE : JSON_FALSE; break;
+			case BSON_DATE: e.type = JSON_DATE; e.data.date = date(); break;
+			case BSON_NULL: e.type = JSON_NULL; break;
+			case BSON_INT: e.type = JSON_INT32; e.data.int32 = int32(); break;
+			case BSON_LONG: e.type = JSON_INT64; e.data.int64 = int64(); break;
+			default: break;
+			}
+
+			return e;
+		}
+	};
+
+	// Length prefixed document read in place. Elements are decoded one at a
+	// time as the iterator reaches them and nothing is allocated. The buffer
+	// must outlive the document and its fields.
+	class document {
+	public:
+		// forward iterator over the elements, a malformed element ends it
+		class iterator {
+		public:
+			typedef std::forward_iterator_tag iterator_category;
+			typedef bson::field value_type;
+			typedef ptrdiff_t difference_type;
+			typedef const bson::field* pointer;
+			typedef const bson::field& reference;
+
+			iterator(const char* p = 0, const char* e = 0)
+				: p(p), e(e)
+			{
+				decode();
+			}
+
+			const bson::field& operator*() const { return f; }
+			const bson::field* operator->() const { return &f; }
+			iterator& operator++()
+			{
+				p = f.data + f.size;
+				decode();
+
+				return *this;
+			}
+			iterator operator++(int)
+			{
+				iterator i(*this);
+
+				++*this;
+
+				return i;
+			}
+			bool operator==(const iterator& i) const { return p == i.p; }
+			bool operator!=(const iterator& i) const { return p != i.p; }
+
+		private:
+			const char* p; // current element, e at the end
+			const char* e; // the terminating null
+			bson::field f;
+
+			void decode()
+			{
+				f.type = BSON_EOO;
+				f.key = json::string_();
+				f.data = p;
+				f.size = 0;
+				if (p == e)
+					return;
+
+				const char* k = p + 1;
+				const char* z = static_cast<const char*>(memchr(k, 0, e - k));
+				if (!z || !value_size(static_cast<bson_type>(*p), z + 1, e, f.size)) {
+					ensure (!"malformed element");
+					p = e;
+					return;
+				}
+				f.type = static_cast<bson_type>(*p);
+				f.key = json::string_(z - k, k);
+				f.data = z + 1;
+			}
+		};
+		typedef iterator const_iterator;
+
+		document()
+			: b(0), n(0)
+		{ }
+		// buf starts with the length of the document
+		explicit document(const char* buf)
+			: b(buf), n(read_int32(buf))
+		{
+			check();
+		}
+		// at most len bytes of buf are read
+		document(const char* buf, size_t len)
+			: b(buf), n(len >= 4 ? read_int32(buf) : 0)
+		{
+			if (n > len)
+				n = 0;
+			check();
+		}
+
+		// false for a truncated or unterminated document
+		bool valid() const
+		{
+			return n != 0;
+		}
+		const char* data() const { return b; }
+		size_t size() const { return n; }
+
+		iterator begin() const
+		{
+			return n ? iterator(b + 4, b + n - 1) : end();
+		}
+		iterator end() const
+		{
+			return n ? iterator(b + n - 1, b + n - 1) : iterator();
+		}
+		// first element with the key k, or end()
+		iterator find(const json::string& k) const
+		{
+			iterator i = begin(), e = end();
+
+			while (i != e && !(i->key == k))
+				++i;
+
+			return i;
+		}
+		iterator find(const char* k) const
+		{
+			return find(json::string_(strlen(k), k));
+		}
+		// the field with key k, false if there is none
+		bson::field operator[](const char* k) const
+		{
+			return *find(k);
+		}
+
+	private:
+		const char* b;
+		size_t n; // 0 if not valid
+
+		void check()
+		{
+			if (n < 5 || b[n - 1] != 0)
+				n = 0;
+		}
+	};
+
+	inline bson::document field::document() const
+	{
+		return type == BSON_OBJECT || type == BSON_ARRAY ? bson::document(data, size) : bson::document();
+	}
+
+	// field at a dotted path such as "a.b.3.c", array elements by index
+	// elements off the path are skipped by their encoded size
+	inline field find(const document& d, const char* path)
+	{
+		document c = d;
+
+		for (;;) {
+			const char* dot = strchr(path, '.');
+			size_t n = dot ? dot - path : strlen(path);
+			document::iterator i = c.find(json::string_(n, path));
+
+			if (!dot || i == c.end())
+				return *i;
+			c = i->document();
+			path = dot + 1;
+		}
+	}
+	inline field find(const char* doc, const char* path)
+	{
+		return find(document(doc), path);
+	}
+
+	// Position of every field of a document by dotted path, built in one
+	// pass for documents that are queried repeatedly. It holds what find
+	// can reach: keys with a dot are left out, and a repeated key is
+	// shadowed by its first occurrence along with everything below it.
+	class path_index {
+	public:
+		path_index()
+		{ }
+		explicit path_index(const document& d)
+		{
+			build(d);
+		}
+
+		void build(const document& d)
+		{
+			struct level {
+				document::iterator i, e;
+				size_t n; // length of the path to the enclosing document
+			};
+			std::vector<level> stack;
+			std::string path;
+
+			doc = d;
+			paths.clear();
+			entries.clear();
+			table.clear();
+			if (!d.valid())
+				return;
+			table.assign(16, 0);
+
+			level top = { d.begin(), d.end(), 0 };
+			stack.push_back(top);
+			while (!stack.empty()) {
+				level& l = stack.back();
+				if (l.i == l.e) {
+					stack.pop_back();
+					continue;
+				}
+
+				field f = *l.i++;
+				if (memchr(f.key.data, '.', f.key.size))
+					continue;
+				size_t n = l.n;
+				path.resize(n);
+				if (n)
+					path += '.';
+				path.append(f.key.data, f.key.size);
+
+				entry e;
+				e.hash = json::hash(path.data(), path.size());
+				e.path = static_cast<uint32_t>(paths.size());
+				e.length = static_cast<uint32_t>(path.size());
+				e.offset = static_cast<uint32_t>(f.key.data - 1 - d.data());
+				if (!insert(e, path))
+					continue;
+				paths += path;
+				entries.push_back(e);
+
+				if (f.type == BSON_OBJECT || f.type == BSON_ARRAY) {
+					document c = f.document();
+					level next = { c.begin(), c.end(), path.size() };
+					stack.push_back(next);
+				}
+			}
+		}
+
+		size_t size() const
+		{
+			return entries.size();
+		}
+		// false if there is no field at path
+		field find(const char* path) const
+		{
+			return find(json::string_(strlen(path), path));
+		}
+		field find(const json::string& path) const
+		{
+			size_t i = position(path);
+
+			return i == entries.size() ? *doc.end()
+				: *document::iterator(doc.data() + entries[i].offset, doc.data() + doc.size() - 1);
+		}
+
+	private:
+		struct entry {
+			uint32_t hash;
+			uint32_t path; // in paths
+			uint32_t length;
+			uint32_t offset; // of the element in the document
+		};
+		document doc;
+		std::string paths;
+		std::vector<entry> entries;
+		std::vector<uint32_t> table; // entry + 1, 0 if empty, at most half full
+
+		bool match(const entry& e, const json::string& path) const
+		{
+			return e.length == path.size && 0 == memcmp(paths.data() + e.path, path.data, path.size);
+		}
+		// e for the next entry at path, false if path is already there
+		bool insert(const entry& e, const std::string& path)
+		{
+			if (2*(entries.size() + 1) > table.size())
+				grow();
+
+			size_t mask = table.size() - 1;
+			size_t j = e.hash & mask;
+			for (; table[j]; j = (j + 1) & mask) {
+				const entry& f = entries[table[j] - 1];
+				if (f.hash == e.hash && match(f, json::string_(path.size(), path.data())))
+					return false;
+			}
+			table[j] = static_cast<uint32_t>(entries.size() + 1);
+
+			return true;
+		}
+		// twice the slots, the entries are already distinct
+		void grow()
+		{
+			size_t n = 2*table.size();
+
+			table.assign(n, 0);
+			for (size_t i = 0; i < entries.size(); ++i) {
+				size_t j = entries[i].hash & (n - 1);
+				while (table[j])
+					j = (j + 1) & (n - 1);
+				table[j] = static_cast<uint32_t>(i + 1);
+			}
+		}
+		// position in entries, or entries.size()
+		size_t position(const json::string& path) const
+		{
+			if (table.empty())
+				return entries.size();
+
+			uint32_t h = json::hash(path.data, path.size);
+			size_t mask = table.size() - 1;
+			for (size_t j = h & mask; table[j]; j = (j + 1) & mask) {
+				const entry& e = entries[table[j] - 1];
+				if (e.hash == h && match(e, path))
+					return table[j] - 1;
+			}
+
+			return entries.size();
+		}
+	};
+
+	//
+	// files of documents
+	//
+
+	// Documents one after another, as mongodump writes them, read in
+	// place from a mapped file or a buffer. Walking them only reads each
+	// length prefix and checks that the document fits and ends in a null.
+	// A malformed document ends the walk; check() says where.
+	class scanner {
+		scanner(const scanner&);
+		scanner& operator=(const scanner&);
+	public:
+		// forward iterator over the documents
+		class iterator {
+		public:
+			typedef std::forward_iterator_tag iterator_category;
+			typedef bson::document value_type;
+			typedef ptrdiff_t difference_type;
+			typedef const bson::document* pointer;
+			typedef const bson::document& reference;
+
+			iterator(const char* p = 0, const char* e = 0)
+				: p(p), e(e)
+			{
+				decode();
+			}
+
+			const bson::document& operator*() const { return d; }
+			const bson::document* operator->() const { return &d; }
+			iterator& operator++()
+			{
+				p += d.size();
+				decode();
+
+				return *this;
+			}
+			iterator operator++(int)
+			{
+				iterator i(*this);
+
+				++*this;
+
+				return i;
+			}
+			bool operator==(const iterator& i) const { return p == i.p; }
+			bool operator!=(const iterator& i) const { return p != i.p; }
+
+		private:
+			const char* p; // current document, e at the end
+			const char* e;
+			bson::document d;
+
+			void decode()
+			{
+				if (p == e)
+					return;
+				d = bson::document(p, e - p);
+				if (!d.valid())
+					p = e;
+			}
+		};
+		typedef iterator const_iterator;
+
+		// the file is mapped, valid() is false if it could not be
+		explicit scanner(const char* path)
+			: f(new json::mapped_file(path)), b(f->data()), n(f->size())
+		{ }
+		// documents in buf, which must outlive the scanner
+		scanner(const char* buf, size_t len)
+			: f(0), b(buf), n(len)
+		{ }
+		~scanner()
+		{
+			delete f;
+		}
+
+		bool valid() const
+		{
+			return !f || f->valid();
+		}
+		const char* data() const { return b; }
+		size_t size() const { return n; }
+
+		iterator begin() const
+		{
+			return iterator(b, b + n);
+		}
+		iterator end() const
+		{
+			return iterator(b + n, b + n);
+		}
+		// offset of the first malformed document, size() if there is none
+		size_t check() const
+		{
+			const char* p = b;
+			const char* e = b + n;
+
+			while (p != e) {
+				bson::document d(p, e - p);
+				if (!d.valid())
+					break;
+				p += d.size();
+			}
+
+			return p - b;
+		}
+
+		// f(document, offset) for each document, up to the first malformed
+		// one, returning how many there were
+		// with more than one thread the boundaries are found first and the
+		// documents shared out in runs of about equal bytes, f is then
+		// called concurrently and in no particular order
+		template<class F>
+		size_t each(F f, unsigned threads = 1)
+		{
+			if (threads <= 1) {
+				size_t k = 0;
+				for (iterator i = begin(), e = end(); i != e; ++i, ++k)
+					f(*i, static_cast<size_t>(i->data() - b));
+
+				return k;
+			}
+
+			std::vector<size_t> at;
+			for (iterator i = begin(), e = end(); i != e; ++i)
+				at.push_back(i->data() - b);
+			size_t last = at.empty() ? 0 : at.back() + read_int32(b + at.back());
+
+			std::vector<std::thread> pool;
+			size_t first = 0;
+			for (unsigned t = 0; t < threads && first < at.size(); ++t) {
+				// up to the document that starts past this thread's share
+				size_t bytes = last*(t + 1)/threads;
+				size_t end = std::lower_bound(at.begin() + first, at.end(), bytes) - at.begin();
+				if (t + 1 == threads)
+					end = at.size();
+				if (end == first)
+					continue;
+				pool.push_back(std::thread([&f, &at, this, first, end]() {
+					for (size_t i = first; i < end; ++i)
+						f(bson::document(b + at[i], n - at[i]), at[i]);
+				}));
+				first = end;
+			}
+			for (size_t t = 0; t < pool.size(); ++t)
+				pool[t].join();
+
+			return at.size();
+		}
+
+	private:
+		json::mapped_file* f; // null over a caller's buffer
+		const char* b;
+		size_t n;
+	};
+
+	//
+	// decoding documents
+	//
+
+	// the elements of d into v as an object, or as an array sized by
+	// counting its elements first, owned by m if it is not null
+	// elements of types json has no place for are left out of both
+	// nesting is kept on an explicit stack so depth is only limited by memory
+	inline void decode(const document& d, bson_type t, json::value& v, json::memory* m = 0)
+	{
+		struct frame {
+			document::iterator i, e;
+			json::object* o; // null for arrays
+			json::array* a; // null for objects
+			size_t n; // next array element
+		};
+		std::vector<frame> stack;
+		document c = d;
+		json::value* w = &v;
+
+		for (;;) {
+			// open c as a new object or array in *w
+			frame f = { c.begin(), c.end(), 0, 0, 0 };
+			if (t == BSON_OBJECT) {
+				if (m) {
+					json::value o(json::object(), *m);
+					w->swap(o);
+				}
+				else {
+					*w = json::object();
+				}
+				f.o = w->data.object;
+			}
+			else {
+				int n = static_cast<int>(std::distance(f.i, f.e));
+				json::value a = m ? json::value(n, *m) : json::value(n);
+				w->swap(a);
+				f.a = &w->data.array;
+			}
+			stack.push_back(f);
+
+			// fill it until an embedded document or array is reached
+			for (w = 0; !w && !stack.empty(); ) {
+				frame& g = stack.back();
+				if (g.i == g.e) {
+#ifdef JSON_FLAT_OBJECT
+					if (g.o)
+						g.o->reindex();
+#endif
+					// less any elements left out
+					if (g.a)
+						g.a->size = g.n;
+					stack.pop_back();
+					continue;
+				}
+
+				field x = *g.i++;
+				bool nest = x.type == BSON_OBJECT || x.type == BSON_ARRAY;
+				json::element e = x.element();
+				json::value* u;
+				if (!nest && e.type == JSON_UNDEFINED)
+					continue;
+				if (g.a) {
+					u = static_cast<json::value*>(&g.a->element[g.n++]);
+				}
+				else {
+#ifdef JSON_FLAT_OBJECT
+					// duplicates are dropped by reindex
+					u = &g.o->append(std::string(x.key.data, x.key.size));
+#else
+					// first key wins, like std::map::insert
+					std::pair<json::object::iterator,bool> i = g.o->insert(std::make_pair(std::string(x.key.data, x.key.size), json::value()));
+					if (!i.second)
+						continue;
+					u = &i.first->second;
+#endif
+				}
+
+				if (nest) {
+					c = x.document();
+					t = x.type;
+					w = u;
+				}
+				else if (m) {
+					u->assign(e, *m);
+				}
+				else {
+					*u = e;
+				}
+			}
+			if (!w)
+				return;
+		}
+	}
+	inline json::object decode(const document& d)
+	{
+		json::object o;
+		json::value v;
+
+		decode(d, BSON_OBJECT, v);
+		o.swap(*v.data.object);
+
+		return o;
+	}
+	// length prefixed document of at most len bytes
+	inline json::object decode(const char* buf, size_t len)
+	{
+		return decode(document(buf, len));
+	}
+	// the values and members come from m, which must outlive them
+	inline json::object decode(const document& d, json::memory& m)
+	{
+		json::value v;
+
+		decode(d, BSON_OBJECT, v, &m);
+
+		// a move keeps the allocator, a swap would not
+		return std::move(*v.data.object);
+	}
+	inline json::object decode(const char* buf, size_t len, json::memory& m)
+	{
+		return decode(document(buf, len), m);
+	}
+	// any field, embedded documents and arrays included
+	inline json::value decode(const field& f)
+	{
+		json::value v;
+
+		if (f.type == BSON_OBJECT || f.type == BSON_ARRAY)
+			decode(f.document(), f.type, v);
+		else
+			v = f.element();
+
+		return v;
+	}
+
 	inline std::pair<std::string,json::value> read(const char*& buf)
 	{
 		bson_type t = type(buf);
 
 		std::string key = bson::key(buf);
+		if (t == BSON_OBJECT || t == BSON_ARRAY) {
+			document d(buf);
+			json::value value;
+
+			decode(d, t, value);
+			buf += read_int32(buf);
+
+			return std::make_pair(std::move(key), std::move(value));
+		}
 		json::value value = bson::value(t, buf);
 
-		return std::make_pair(key, value);
+		return std::make_pair(std::move(key), std::move(value));
+	}
+
+	//
+	// structs
+	//
+
+	// Structs with JSON_FIELDS written as documents and read back by key,
+	// without going through json::value.
+	inline size_t write_member(const char* key, bool b, sink& s) { return write(key, b, s); }
+	inline size_t write_member(const char* key, int32_t i, sink& s) { return write(key, i, s); }
+	inline size_t write_member(const char* key, int64_t i, sink& s) { return write_long(key, i, s); }
+	inline size_t write_member(const char* key, double d, sink& s) { return write(key, d, s); }
+	inline size_t write_member(const char* key, const std::string& v, sink& s)
+	{
+		return write(key, json::string_(v.size(), v.data()), s);
+	}
+	template<class T> size_t write_member(const char* key, const std::vector<T>& v, sink& s);
+	template<class T> size_t write_member(const char* key, const T& v, sink& s);
+	template<class T> bool encode(const T& v, sink& s);
+
+	// stops at the first member that does not fit
+	struct member_writer {
+		sink& s;
+
+		template<class T, size_t N>
+		bool operator()(const char (&name)[N], const T& m)
+		{
+			return write_member(name, m, s) != 0;
+		}
+	};
+
+	template<class T>
+	size_t write_member(const char* key, const std::vector<T>& v, sink& s)
+	{
+		size_t n = s.size(), start;
+		char* buf = write_key(BSON_ARRAY, key, 0, s);
+
+		if (!buf)
+			return 0;
+		s.commit(buf);
+		if (!open_document(s, start))
+			return 0;
+		char index[21];
+		for (size_t i = 0; i < v.size(); ++i)
+			if (!write_member(index_key(i, index), v[i], s))
+				return 0;
+		if (!close_document(s, start))
+			return 0;
+
+		return s.size() - n;
+	}
+	template<class T>
+	size_t write_member(const char* key, const T& v, sink& s)
+	{
+		size_t n = s.size();
+		char* buf = write_key(BSON_OBJECT, key, 0, s);
+
+		if (!buf)
+			return 0;
+		s.commit(buf);
+		if (!encode(v, s))
+			return 0;
+
+		return s.size() - n;
+	}
+	template<class T>
+	bool encode(const T& v, sink& s)
+	{
+		member_writer w = { s };
+		size_t start;
+
+		if (!open_document(s, start))
+			return false;
+		T::json_fields_(v, w);
+		close_document(s, start);
+
+		return !s.overflow();
+	}
+
+	// false if a field does not have the type of its member, integers
+	// are taken by a wider member and doubles also from integers
+	inline bool read_member(const field& f, bool& b)
+	{
+		b = f.type == BSON_BOOL && f.boolean();
+
+		return f.type == BSON_BOOL;
+	}
+	inline bool read_member(const field& f, int64_t& i)
+	{
+		if (f.type == BSON_INT)
+			i = f.int32();
+		else if (f.type == BSON_LONG)
+			i = f.int64();
+		else
+			return false;
+
+		return true;
+	}
+	inline bool read_member(const field& f, int32_t& i)
+	{
+		if (f.type != BSON_INT)
+			return false;
+		i = f.int32();
+
+		return true;
+	}
+	inline bool read_member(const field& f, double& d)
+	{
+		int64_t i;
+
+		if (f.type == BSON_DOUBLE)
+			d = f.number();
+		else if (read_member(f, i))
+			d = static_cast<double>(i);
+		else
+			return false;
+
+		return true;
+	}
+	inline bool read_member(const field& f, std::string& s)
+	{
+		if (f.type != BSON_STRING)
+			return false;
+		s.assign(f.string().data, f.string().size);
+
+		return true;
+	}
+	template<class T> bool read_member(const field& f, std::vector<T>& v);
+	template<class T> bool read_member(const field& f, T& v);
+	template<class T> bool decode(const document& d, T& v);
+
+	struct member_reader {
+		const field& f;
+		bool found;
+		bool ok;
+
+		template<class T, size_t N>
+		bool operator()(const char (&name)[N], T& m)
+		{
+			if (f.key.size != N - 1 || memcmp(f.key.data, name, N - 1))
+				return true;
+			found = true;
+			ok = read_member(f, m);
+
+			return false;
+		}
+	};
+
+	template<class T>
+	bool read_member(const field& f, std::vector<T>& v)
+	{
+		if (f.type != BSON_ARRAY)
+			return false;
+
+		document d = f.document();
+		v.clear();
+		v.reserve(std::distance(d.begin(), d.end()));
+		for (document::iterator i = d.begin(); i != d.end(); ++i) {
+			v.push_back(T());
+			if (!read_member(*i, v.back()))
+				return false;
+		}
+
+		return d.valid();
+	}
+	template<class T>
+	bool read_member(const field& f, T& v)
+	{
+		return f.type == BSON_OBJECT && decode(f.document(), v);
+	}
+	// members without a field are left as they are, other fields skipped
+	template<class T>
+	bool decode(const document& d, T& v)
+	{
+		for (document::iterator i = d.begin(); i != d.end(); ++i) {
+			member_reader r = { *i, false, false };
+			T::json_fields_(v, r);
+			if (r.found && !r.ok)
+				return false;
+		}
+
+		return d.valid();
 	}
 
 } // namepace bson
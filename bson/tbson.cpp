@@ -9,6 +9,21 @@ using bson::read;
 using json::string;
 using json::string_;
 
+// structs read and written without a tree
+struct item {
+	std::string sku;
+	int32_t count;
+	double price;
+	JSON_FIELDS(sku, count, price)
+};
+struct order {
+	int64_t id;
+	bool paid;
+	std::vector<item> items;
+	std::vector<int32_t> codes;
+	JSON_FIELDS(id, paid, items, codes)
+};
+
 const char* hw ="\x16\x00\x00\x00\x02hello\x00\x06\x00\x00\x00world\x00\x00";
 
 void test_read(void)
@@ -59,11 +74,368 @@ void test_write(void)
 	assert (kv.second == false);
 }
 
+void test_encode(void)
+{
+	json::object o;
+	o["hello"] = json::value("world");
+	std::vector<char> doc = encode(o);
+	assert (doc.size() == 0x16 && 0 == memcmp(&doc[0], hw, doc.size()));
+
+	// {"a": {"b": 1}, "c": [true, null]}
+	const char nested[] =
+		"\x27\x00\x00\x00"
+		"\x03" "a\x00" "\x10\x00\x00\x00" "\x01" "b\x00" "\x00\x00\x00\x00\x00\x00\xf0\x3f" "\x00"
+		"\x04" "c\x00" "\x0c\x00\x00\x00" "\x08" "0\x00" "\x01" "\x0a" "1\x00" "\x00"
+		"\x00";
+	const char* json = "{\"a\": {\"b\": 1.0}, \"c\": [true, null]}";
+	json::object p = json::parse::read_object(json, strlen(json));
+	doc = encode(p);
+	assert (doc.size() == sizeof(nested) - 1 && doc.size() == size(p));
+	assert (0 == memcmp(&doc[0], nested, doc.size()));
+}
+
+void test_sink(void)
+{
+	const char* json = "{\"a\": {\"b\": 1}, \"c\": [true, null], \"d\": \"text\"}";
+	json::object o = json::parse::read_object(json, strlen(json));
+	std::vector<char> doc = encode(o);
+
+	// growable, starting too small
+	sink g(4);
+	assert (encode(o, g) && g.size() == doc.size());
+	assert (0 == memcmp(g.data(), &doc[0], doc.size()));
+	g.clear();
+	write("hello", "world", g);
+	assert (g.size() == 0x16 - 5 && 0 == memcmp(g.data(), hw + 4, g.size()));
+
+	// fixed buffers never write past their end
+	char buf[64];
+	memset(buf, 'x', sizeof(buf));
+	for (size_t n = 0; n < doc.size(); ++n) {
+		sink s(buf, n);
+		assert (!encode(o, s) && s.overflow() && s.size() <= n);
+		assert (buf[n] == 'x');
+	}
+	sink s(buf, doc.size());
+	assert (encode(o, s) && s.size() == doc.size());
+	assert (0 == memcmp(buf, &doc[0], doc.size()));
+
+	// nothing follows an element that did not fit, even one that would
+	sink t(buf, 40);
+	write("big", "a string longer than the forty bytes of the sink", t);
+	assert (t.overflow() && t.size() == 0);
+	write("n", 1.5, t);
+	assert (t.size() == 0);
+	t.clear();
+	write("n", 1.5, t);
+	assert (!t.overflow() && t.size() == 11);
+
+	// keys are null terminated, one with a null inside is not written
+	const char* nul = "{\"a\": 1, \"n\": {\"k\\u0000ey\": 2}}";
+	json::object p = json::parse::read_object(nul, strlen(nul));
+	assert (p["n"].data.object->begin()->first.size() == 4);
+	assert (encode(p).empty());
+	g.clear();
+	assert (!encode(p, g) && g.overflow());
+}
+
+void test_index_key(void)
+{
+	char buf[21];
+	const size_t n[] = { 0, 9, 10, 99, 100, 999, 1000, 123456789, SIZE_MAX };
+
+	for (size_t i = 0; i < sizeof(n)/sizeof(*n); ++i)
+		assert (std::to_string(n[i]) == index_key(n[i], buf));
+
+	json::value a;
+	for (int i = 0; i < 1234; ++i)
+		a.push_back(json::value(static_cast<double>(i)));
+	json::object o;
+	o["a"] = a;
+	std::vector<char> doc = encode(o);
+	assert (doc.size() == size(o));
+
+	const char* t = &doc[0] + 4 + 1 + 2 + 4;
+	for (int i = 0; i < 1234; ++i) {
+		json::pair kv = read(t);
+		assert (kv.first == std::to_string(i) && kv.second == static_cast<double>(i));
+	}
+	assert (*t == 0);
+}
+
+void test_document(void)
+{
+	const char* json = "{\"s\": \"text\", \"n\": 2.5, \"o\": {\"t\": true, \"z\": null}, \"a\": [1, \"x\", [3]]}";
+	json::object o = json::parse::read_object(json, strlen(json));
+	std::vector<char> buf = encode(o);
+	document d(&buf[0], buf.size());
+	assert (d.valid() && d.size() == buf.size());
+
+	size_t n = 0;
+	for (document::iterator i = d.begin(); i != d.end(); ++i, ++n) {
+		assert (i->key.data >= &buf[0] && i->key.data < &buf[0] + buf.size());
+		assert (o[std::string(i->key.data, i->key.size)] == json::value(i->element()) || i->type == BSON_OBJECT || i->type == BSON_ARRAY);
+	}
+	assert (n == o.size());
+
+	field s = d["s"];
+	assert (s.type == BSON_STRING && s.string() == "text");
+	assert (s.string().data == s.data + 4);
+	assert (d["n"].number() == 2.5);
+	assert (!d["missing"] && d.find("missing") == d.end());
+
+	document e = d["o"].document();
+	assert (e.valid() && e["t"].type == BSON_BOOL && e["t"].boolean());
+	assert (e["z"].type == BSON_NULL);
+
+	document a = d["a"].document();
+	document::iterator i = a.begin();
+	assert (i->key == "0" && i->type == BSON_LONG && i->int64() == 1);
+	++i;
+	assert (i->key == "1" && i->string() == "x");
+	++i;
+	assert (i->key == "2" && i->document().begin()->int64() == 3);
+	assert (++i == a.end());
+
+	// truncated or unterminated buffers are rejected without reading past them
+	assert (!document(&buf[0], buf.size() - 1).valid());
+	assert (!document(&buf[0], 3).valid());
+}
+
+void test_find(void)
+{
+	const char* json = "{\"a\": {\"b\": [0, 1, 2, {\"c\": \"deep\"}], \"s\": \"skip\"}, \"x\": 1, \"a.b\": 2}";
+	json::object o = json::parse::read_object(json, strlen(json));
+	std::vector<char> buf = encode(o);
+	document d(&buf[0], buf.size());
+
+	assert (find(d, "a.b.3.c").string() == "deep");
+	assert (find(&buf[0], "a.b.1").int64() == 1);
+	assert (find(d, "x").int64() == 1);
+	assert (find(d, "a").type == BSON_OBJECT);
+	assert (!find(d, "a.b.4") && !find(d, "a.s.t") && !find(d, "y") && !find(d, "a.b.3.c.d"));
+
+	path_index ix(d);
+	assert (ix.size() == 9);
+	assert (ix.find("a.b.3.c").string() == "deep");
+	assert (ix.find("a.b.3.c").string().data == find(d, "a.b.3.c").string().data);
+	assert (ix.find("a.s").string() == "skip");
+	assert (ix.find("x").int64() == 1);
+	// the nested a.b comes first, the top level key "a.b" is not reachable by path
+	assert (ix.find("a.b").type == BSON_ARRAY);
+	assert (!ix.find("a.b.4") && !ix.find("") && !ix.find("z"));
+
+	// documents json::object does not write: a dotted key ahead of the path
+	// it looks like, and a repeated key, find only sees the first
+	json::object b = json::parse::read_object("{\"b\": 1}", 8);
+	json::object x = json::parse::read_object("{\"x\": 1}", 8);
+	sink s;
+	size_t start = 0;
+	open_document(s, start);
+	write_long("a.b", 2, s);
+	write("a", b, s);
+	close_document(s, start);
+	document e(s.data(), s.size());
+	assert (find(e, "a.b").int64() == 1 && path_index(e).find("a.b").int64() == 1);
+
+	sink t;
+	open_document(t, start);
+	write("a", x, t);
+	write("a", b, t);
+	close_document(t, start);
+	document f(t.data(), t.size());
+	path_index fx(f);
+	assert (!find(f, "a.b") && !fx.find("a.b"));
+	assert (find(f, "a.x").int64() == 1 && fx.find("a.x").int64() == 1 && fx.size() == 2);
+}
+
+void test_decode(void)
+{
+	const char* json = "{\"s\": \"text\", \"o\": {\"a\": [1, [true, null], {\"b\": \"x\"}], \"e\": {}}, \"n\": 2.5, \"z\": []}";
+	json::object o = json::parse::read_object(json, strlen(json));
+	std::vector<char> buf = encode(o);
+
+	// null != null, so compare the encodings
+	json::object p = decode(&buf[0], buf.size());
+	assert (p.size() == o.size() && encode(p) == buf);
+	json::object& q = *p["o"].data.object;
+	assert (q["a"].data.array.size == 3 && q["a"].capacity() == 3);
+	assert (q["a"][1][0] == true && q["a"][1][1].type == JSON_NULL);
+	assert (!(q["a"][2].flags & JSON_BORROWED));
+
+	// values and members from a memory, here an arena
+	json::arena m(64);
+	{
+		json::object u = decode(&buf[0], buf.size(), m);
+		assert (encode(u) == buf && u.get_allocator().resource() == &m);
+		assert ((*u["o"].data.object)["a"].flags & JSON_MEMORY);
+		assert (u["s"] == "text");
+	}
+
+	// read decodes embedded documents
+	const char* t = &buf[0] + 4;
+	json::pair kv;
+	do
+		kv = read(t);
+	while (kv.first != "o");
+	assert (kv.second.type == JSON_OBJECT && encode(*kv.second.data.object) == encode(q));
+
+	json::value a = decode(find(&buf[0], "o.a"));
+	assert (a.type == JSON_ARRAY && a[2] == q["a"][2]);
+
+	json::value b(1);
+	uint8_t bytes[] = { 1, 2, 3 };
+	b[0] = json::value(3, bytes);
+	json::object r;
+	r["b"] = b;
+	buf = encode(r);
+	assert (decode(&buf[0], buf.size()) == r);
+
+	// decoding keeps its own stack, destroying the tree still recurses
+	const size_t depth = 10000;
+	// length, type, key "0" and the terminator per level
+	std::vector<char> deep(depth*(4 + 1 + 2 + 1) + 5);
+	for (size_t i = 0; i < depth; ++i) {
+		char* d = &deep[0] + i*7;
+		write_int32(static_cast<int32_t>(deep.size() - i*8), d);
+		d[4] = BSON_ARRAY;
+		d[5] = '0';
+	}
+	write_int32(5, &deep[0] + depth*7);
+	json::object s = decode(&deep[0], deep.size());
+	assert (s.size() == 1 && s["0"].type == JSON_ARRAY);
+
+	// types json has no place for are left out of arrays as well as objects
+	sink u;
+	size_t start = 0, inner = 0;
+	open_document(u, start);
+	u.commit(write_key(BSON_ARRAY, "a", 0, u));
+	open_document(u, inner);
+	write_long("0", 1, u);
+	u.commit(write_key(BSON_UNDEFINED, "1", 0, u));
+	write_long("2", 2, u);
+	close_document(u, inner);
+	u.commit(write_key(BSON_UNDEFINED, "u", 0, u));
+	close_document(u, start);
+	json::object x = decode(u.data(), u.size());
+	assert (x.size() == 1 && x["a"].data.array.size == 2);
+	assert (x["a"][0].data.int64 == 1 && x["a"][1].data.int64 == 2);
+	json::arena ar;
+	assert (decode(u.data(), u.size(), ar)["a"].data.array.size == 2);
+}
+
+void test_fields(void)
+{
+	order o;
+	o.id = 1ll << 40;
+	o.paid = true;
+	item i[] = { { "a-1", 2, 9.5 }, { "b", -1, 0 } };
+	o.items.assign(i, i + 2);
+	o.codes.push_back(7);
+
+	sink s;
+	assert (encode(o, s));
+
+	// plain BSON, the tree writes the same fields in key order
+	json::object t = decode(s.data(), s.size());
+	assert (t["id"] == 1099511627776. && t["paid"] == true);
+	assert (t["items"].data.array.size == 2 && (*t["items"][0].data.object)["sku"] == "a-1" && t["codes"][0] == 7.);
+	std::vector<char> v = encode(t);
+	assert (v.size() == s.size());
+
+	order r;
+	r.paid = false;
+	assert (decode(document(s.data(), s.size()), r));
+	assert (r.id == o.id && r.paid && r.codes == o.codes && r.items.size() == 2);
+	assert (r.items[0].sku == "a-1" && r.items[1].count == -1 && r.items[0].price == 9.5);
+
+	// a field of another type is an error, unknown ones are skipped
+	sink b;
+	json::object u;
+	u["id"] = json::value("x");
+	encode(u, b);
+	assert (!decode(document(b.data(), b.size()), r));
+	b.clear();
+	u.clear();
+	u["other"] = json::value(1.5);
+	u["paid"] = json::value(false);
+	encode(u, b);
+	assert (decode(document(b.data(), b.size()), r) && !r.paid && r.id == o.id);
+
+	// a fixed sink that is too small stops
+	char small[16];
+	sink f(small, sizeof(small));
+	assert (!encode(o, f) && f.overflow());
+}
+
+void test_scanner(void)
+{
+	// documents back to back, then one cut short
+	std::string dump;
+	std::vector<size_t> at;
+	for (int i = 0; i < 1000; ++i) {
+		json::object o;
+		o["i"] = json::value(static_cast<double>(i));
+		o["s"] = json::value(std::string(i % 50, 'x').c_str());
+		std::vector<char> d = encode(o);
+		at.push_back(dump.size());
+		dump.append(d.begin(), d.end());
+	}
+	size_t good = dump.size();
+	dump.append("\x20\x00\x00\x00\x01", 5);
+
+	scanner s(dump.data(), dump.size());
+	assert (s.valid() && s.check() == good);
+	size_t k = 0;
+	for (scanner::iterator i = s.begin(); i != s.end(); ++i, ++k)
+		assert (i->data() == dump.data() + at[k] && (*i)["i"].number() == k);
+	assert (k == 1000);
+
+	for (unsigned t = 1; t <= 4; ++t) {
+		std::vector<int> seen(1000);
+		size_t n = s.each([&](const document& d, size_t offset) {
+			size_t i = static_cast<size_t>(d["i"].number());
+			assert (at[i] == offset);
+			++seen[i];
+		}, t);
+		assert (n == 1000 && std::count(seen.begin(), seen.end(), 1) == 1000);
+	}
+
+	// from a file
+	const char* path = "tbson.bson";
+	FILE* f = fopen(path, "wb");
+	fwrite(dump.data(), 1, good, f);
+	fclose(f);
+	{
+		scanner m(path);
+		assert (m.valid() && m.size() == good && m.check() == good);
+		assert (m.each([](const document&, size_t) { }, 2) == 1000);
+	}
+	remove(path);
+	assert (!scanner(path).valid());
+}
+
 int main()
 {
 	test_read();
 
 	test_write();
 
+	test_encode();
+
+	test_sink();
+
+	test_index_key();
+
+	test_document();
+
+	test_find();
+
+	test_decode();
+
+	test_fields();
+
+	test_scanner();
+
 	return 0;
 } 
\ No newline at end of file
@@ -1,17 +1,41 @@
 // json.h - Lightweight C++ wrappers for mongo C library.
+#pragma once
+#include <cctype>
+#include <clocale>
+#include <cmath>
 #include <cstring>
 #include <cstdint>
+#include <cstdlib>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
 #include <functional>
 #include <iostream>
 #include <map>
+#include <mutex>
+#include <new>
 #include <string>
+#include <thread>
 #include <vector>
 #include <utility>
 #ifndef ensure
 #include <cassert>
 #define ensure assert
 #endif // ensure
+#ifndef JSON_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JSON_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define JSON_AVX2
+#include <immintrin.h>
+#endif
+#endif // JSON_NO_SIMD
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 using namespace std::rel_ops;
 
@@ -33,12 +57,414 @@ typedef enum {
 	JSON_UNDEFINED // "empty" type
 } json_element_type;
 
+typedef enum {
+	JSON_OWNED = 0,
+	JSON_BORROWED = 1, // payload is not owned by the element, e.g. it lives in an arena
+	JSON_ESCAPED = 2,  // string still has its JSON escapes, see json::unescape
+	JSON_INLINE = 4,   // short string held in the element itself, see element::str
+	JSON_MEMORY = 8    // payload from a json::memory other than the heap, kept in front of it
+} json_element_flags;
+
 namespace json {
 
+	// 32 bit hash of a byte string
+	inline uint32_t hash(const char* s, size_t n)
+	{
+		const uint64_t m = 0xFF51AFD7ED558CCDull;
+		uint64_t h = 0x9E3779B97F4A7C15ull ^ n, w;
+
+		for (; n >= 8; s += 8, n -= 8) {
+			memcpy(&w, s, 8);
+			h = (h ^ w)*m;
+			h ^= h >> 32;
+		}
+		w = 0;
+		memcpy(&w, s, n);
+		h = (h ^ w)*m;
+		h ^= h >> 29;
+
+		return static_cast<uint32_t>(h);
+	}
+
+	// Source of the memory for owned values and the members of their objects,
+	// e.g. a pool per thread or huge pages. Values made with one come back to
+	// it when destroyed, so it must outlive them. The heap is the default.
+	class memory {
+	public:
+		virtual ~memory() { }
+		virtual void* allocate(size_t n, size_t align = sizeof(void*)) = 0;
+		virtual void deallocate(void* p, size_t n, size_t align = sizeof(void*)) = 0;
+	};
+	// json::allocate and json::deallocate, with alloc_stats
+	inline memory& heap();
+	inline void* allocate(size_t n);
+	inline void deallocate(void* p, size_t n);
+
+	// Standard allocator over a json::memory, the counted heap if there is
+	// none. Copies of a container go back to the default, like std::pmr.
+	template<class T>
+	class allocator {
+	public:
+		typedef T value_type;
+
+		allocator()
+			: m(0)
+		{ }
+		allocator(json::memory* m)
+			: m(m)
+		{ }
+		template<class U>
+		allocator(const allocator<U>& a)
+			: m(a.resource())
+		{ }
+
+		T* allocate(size_t n)
+		{
+			return static_cast<T*>(m ? m->allocate(n*sizeof(T), alignof(T)) : json::allocate(n*sizeof(T)));
+		}
+		void deallocate(T* p, size_t n)
+		{
+			if (m)
+				m->deallocate(p, n*sizeof(T), alignof(T));
+			else
+				json::deallocate(p, n*sizeof(T));
+		}
+		allocator select_on_container_copy_construction() const
+		{
+			return allocator();
+		}
+
+		json::memory* resource() const
+		{
+			return m;
+		}
+		friend bool operator==(const allocator& a, const allocator& b)
+		{
+			return a.m == b.m;
+		}
+		friend bool operator!=(const allocator& a, const allocator& b)
+		{
+			return a.m != b.m;
+		}
+	private:
+		json::memory* m;
+	};
+
+	// Members stored contiguously in insertion order with the part of the
+	// std::map interface json uses. Small maps are searched linearly, larger
+	// ones through an open addressing table of hashes and positions.
+	// Members are relocated with swap, so growing never deep copies.
+	template<class K, class V, class Alloc = std::allocator<std::pair<K,V> > >
+	class flat_map {
+	public:
+		typedef K key_type;
+		typedef V mapped_type;
+		typedef std::pair<K,V> value_type;
+		typedef Alloc allocator_type;
+		typedef typename std::vector<value_type,Alloc>::iterator iterator;
+		typedef typename std::vector<value_type,Alloc>::const_iterator const_iterator;
+
+		flat_map()
+		{ }
+		explicit flat_map(const Alloc& a)
+			: v(a)
+		{ }
+		// keeps the first of duplicate keys, like std::map
+		template<class I>
+		flat_map(I b, I e)
+		{
+			for (; b != e; ++b)
+				append(b->first) = b->second;
+			reindex();
+		}
+
+		iterator begin() { return v.begin(); }
+		iterator end() { return v.end(); }
+		const_iterator begin() const { return v.begin(); }
+		const_iterator end() const { return v.end(); }
+		size_t size() const { return v.size(); }
+		bool empty() const { return v.empty(); }
+		void clear() { v.clear(); table.clear(); }
+		void swap(flat_map& m) { v.swap(m.v); table.swap(m.table); }
+		Alloc get_allocator() const { return v.get_allocator(); }
+
+		iterator find(const K& k)
+		{
+			return v.begin() + position(k);
+		}
+		const_iterator find(const K& k) const
+		{
+			return v.begin() + position(k);
+		}
+		size_t count(const K& k) const
+		{
+			return position(k) != v.size();
+		}
+		std::pair<iterator,bool> insert(const value_type& kv)
+		{
+			size_t i = position(kv.first);
+
+			if (i != v.size())
+				return std::make_pair(v.begin() + i, false);
+
+			append(kv.first) = kv.second;
+			add_index();
+
+			return std::make_pair(v.end() - 1, true);
+		}
+		std::pair<iterator,bool> insert(value_type&& kv)
+		{
+			size_t i = position(kv.first);
+
+			if (i != v.size())
+				return std::make_pair(v.begin() + i, false);
+
+			append(std::move(kv.first)) = std::move(kv.second);
+			add_index();
+
+			return std::make_pair(v.end() - 1, true);
+		}
+		// the value is only constructed from a if k is new, like std::map
+		template<class... A>
+		std::pair<iterator,bool> emplace(const K& k, A&&... a)
+		{
+			size_t i = position(k);
+
+			if (i != v.size())
+				return std::make_pair(v.begin() + i, false);
+
+			append(k) = V(std::forward<A>(a)...);
+			add_index();
+
+			return std::make_pair(v.end() - 1, true);
+		}
+		V& operator[](const K& k)
+		{
+			size_t i = position(k);
+
+			if (i != v.size())
+				return v[i].second;
+
+			append(k);
+			add_index();
+
+			return v.back().second;
+		}
+		size_t erase(const K& k)
+		{
+			size_t i = position(k);
+
+			if (i == v.size())
+				return 0;
+			remove(i);
+			reindex();
+
+			return 1;
+		}
+
+		// bulk building: append without looking for duplicates, then reindex once
+		V& append(const K& k)
+		{
+			grow();
+			v.push_back(value_type());
+			v.back().first = k;
+
+			return v.back().second;
+		}
+		V& append(K&& k)
+		{
+			grow();
+			v.push_back(value_type());
+			v.back().first = std::move(k);
+
+			return v.back().second;
+		}
+		// rebuild the index and drop all but the first of duplicate keys
+		void reindex()
+		{
+			table.clear();
+			if (v.size() <= linear) {
+				for (size_t i = 1; i < v.size(); ++i) {
+					size_t j = 0;
+					while (j < i && !(v[j].first == v[i].first))
+						++j;
+					if (j < i)
+						remove(i--);
+				}
+
+				return;
+			}
+
+			size_t n = 16;
+			while (n < 2*v.size())
+				n *= 2;
+			table.assign(n, empty_slot());
+			// one pass, survivors move down over the duplicates
+			size_t k = 0;
+			for (size_t i = 0; i < v.size(); ++i) {
+				if (k != i)
+					swap_(v[k], v[i]);
+				if (add_slot(k))
+					++k;
+			}
+			if (k != v.size()) {
+				v.erase(v.begin() + k, v.end());
+				if (v.size() <= linear)
+					table.clear();
+			}
+		}
+
+		bool operator==(const flat_map& m) const
+		{
+			if (size() != m.size())
+				return false;
+			for (size_t i = 0; i < v.size(); ++i) {
+				size_t j = m.position(v[i].first);
+				if (j == m.v.size() || !(v[i].second == m.v[j].second))
+					return false;
+			}
+
+			return true;
+		}
+		// compare in key order, like std::map
+		bool operator<(const flat_map& m) const
+		{
+			std::vector<size_t> i = sorted(), j = m.sorted();
+
+			for (size_t k = 0; k < i.size() && k < j.size(); ++k) {
+				if (v[i[k]] < m.v[j[k]])
+					return true;
+				if (m.v[j[k]] < v[i[k]])
+					return false;
+			}
+
+			return i.size() < j.size();
+		}
+
+	private:
+		enum { linear = 8 }; // largest map searched without a table
+		struct slot {
+			uint32_t hash;
+			uint32_t pos; // UINT32_MAX if empty
+		};
+		std::vector<value_type,Alloc> v;
+		std::vector<slot> table; // empty if size() <= linear, otherwise at most half full
+
+		static slot empty_slot()
+		{
+			slot s = { 0, UINT32_MAX };
+
+			return s;
+		}
+		static uint32_t hash_(const K& k)
+		{
+			return json::hash(k.data(), k.size());
+		}
+		// position of k in v, or v.size()
+		size_t position(const K& k) const
+		{
+			if (table.empty()) {
+				size_t i = 0;
+				while (i < v.size() && !(v[i].first == k))
+					++i;
+
+				return i;
+			}
+
+			uint32_t h = hash_(k);
+			size_t mask = table.size() - 1;
+			for (size_t i = h & mask; table[i].pos != UINT32_MAX; i = (i + 1) & mask) {
+				if (table[i].hash == h && v[table[i].pos].first == k)
+					return table[i].pos;
+			}
+
+			return v.size();
+		}
+		// false if the key at position i is already in the table
+		bool add_slot(size_t i)
+		{
+			uint32_t h = hash_(v[i].first);
+			size_t mask = table.size() - 1, j = h & mask;
+
+			for (; table[j].pos != UINT32_MAX; j = (j + 1) & mask) {
+				if (table[j].hash == h && v[table[j].pos].first == v[i].first)
+					return false;
+			}
+			table[j].hash = h;
+			table[j].pos = static_cast<uint32_t>(i);
+
+			return true;
+		}
+		// after appending a key known to be new
+		void add_index()
+		{
+			if (table.empty() ? v.size() > linear : 2*v.size() > table.size())
+				reindex();
+			else if (!table.empty())
+				add_slot(v.size() - 1);
+		}
+		struct less_position {
+			const std::vector<value_type,Alloc>* v;
+			less_position(const std::vector<value_type,Alloc>& v)
+				: v(&v)
+			{ }
+			bool operator()(size_t i, size_t j) const
+			{
+				return (*v)[i].first < (*v)[j].first;
+			}
+		};
+		std::vector<size_t> sorted() const
+		{
+			std::vector<size_t> i(v.size());
+
+			for (size_t k = 0; k < i.size(); ++k)
+				i[k] = k;
+			std::sort(i.begin(), i.end(), less_position(v));
+
+			return i;
+		}
+		void remove(size_t i)
+		{
+			for (; i + 1 < v.size(); ++i)
+				swap_(v[i], v[i + 1]);
+			v.pop_back();
+		}
+		static void swap_(value_type& a, value_type& b)
+		{
+			using std::swap;
+
+			swap(a.first, b.first);
+			swap(a.second, b.second);
+		}
+		// make room for one more without copying members
+		void grow()
+		{
+			if (v.size() < v.capacity())
+				return;
+
+			std::vector<value_type,Alloc> w(v.get_allocator());
+			w.reserve(v.size() < 4 ? 8 : 2*v.size());
+			for (size_t i = 0; i < v.size(); ++i) {
+				w.push_back(value_type());
+				swap_(w.back(), v[i]);
+			}
+			v.swap(w);
+		}
+	};
+
 	class value;
 	struct element;
 	typedef std::pair<std::string,json::value> pair;
-	typedef std::map<std::string, value> object;
+#ifdef JSON_FLAT_OBJECT
+	typedef flat_map<std::string, value, json::allocator<std::pair<std::string,value> > > object;
+#else
+	typedef std::map<std::string, value, std::less<std::string>, json::allocator<std::pair<const std::string,value> > > object;
+#endif
+	namespace parse { class builder; }
+
+	// defined after value is complete
+	inline bool object_equal(const object* a, const object* b);
+	inline bool object_less(const object* a, const object* b);
 
 	// POD types for holding the bits
 	struct string {
@@ -55,6 +481,98 @@ namespace json {
 		return s;
 	}
 
+	inline void append_utf8(unsigned u, std::string& out)
+	{
+		if (u < 0x80) {
+			out += static_cast<char>(u);
+		}
+		else if (u < 0x800) {
+			out += static_cast<char>(0xC0 | (u >> 6));
+			out += static_cast<char>(0x80 | (u & 0x3F));
+		}
+		else if (u < 0x10000) {
+			out += static_cast<char>(0xE0 | (u >> 12));
+			out += static_cast<char>(0x80 | ((u >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (u & 0x3F));
+		}
+		else {
+			out += static_cast<char>(0xF0 | (u >> 18));
+			out += static_cast<char>(0x80 | ((u >> 12) & 0x3F));
+			out += static_cast<char>(0x80 | ((u >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (u & 0x3F));
+		}
+	}
+	inline unsigned read_hex4(const char*& s, const char* e)
+	{
+		unsigned u = 0;
+
+		for (int i = 0; i < 4 && s != e; ++i, ++s) {
+			char c = *s;
+			ensure (isxdigit(static_cast<unsigned char>(c)));
+			u = (u << 4) | (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+		}
+
+		return u;
+	}
+	// decode the escape starting at the backslash s, append it to out
+	// and return the position after it
+	inline const char* unescape(const char* s, const char* e, std::string& out)
+	{
+		if (e - s < 2) {
+			ensure (!"truncated escape");
+
+			return e;
+		}
+
+		char c = s[1];
+		s += 2;
+		switch (c) {
+		case 'b': out += '\b'; break;
+		case 'f': out += '\f'; break;
+		case 'n': out += '\n'; break;
+		case 'r': out += '\r'; break;
+		case 't': out += '\t'; break;
+		case 'u': {
+			// UTF-16 to UTF-8
+			unsigned u = read_hex4(s, e);
+			if (u >= 0xD800 && u < 0xDC00 && e - s >= 6 && s[0] == '\\' && s[1] == 'u') {
+				s += 2;
+				unsigned l = read_hex4(s, e);
+				if (l >= 0xDC00 && l < 0xE000) {
+					u = 0x10000 + ((u - 0xD800) << 10) + (l - 0xDC00);
+				}
+				else {
+					append_utf8(u, out);
+					u = l;
+				}
+			}
+			append_utf8(u, out);
+			break;
+		}
+		default: out += c; // \" \\ \/ \'
+		}
+
+		return s;
+	}
+	inline std::string unescape(const string& s)
+	{
+		std::string out;
+		const char* p = s.data;
+		const char* e = s.data + s.size;
+
+		out.reserve(s.size);
+		while (p != e) {
+			const char* b = p;
+			while (p != e && *p != '\\')
+				++p;
+			out.append(b, p);
+			if (p != e)
+				p = unescape(p, e, out);
+		}
+
+		return out;
+	}
+
 	struct array {
 		size_t size;
 		json::element* element;
@@ -86,6 +604,7 @@ namespace json {
 	struct element {
 		union {
 			json::string string;
+			char chars[sizeof(json::string)]; // JSON_INLINE strings
 			double number;
 			json::object* object;
 			json::array array;
@@ -97,67 +616,1378 @@ namespace json {
 #endif
 		} data;
 		json_element_type type;
+		unsigned char flags; // only meaningful for types with a payload
+
+		// contents of a JSON_STRING, wherever they are held
+		// inline strings are null terminated in chars and the last byte
+		// counts the unused ones, so it is also the terminator when full
+		json::string str() const
+		{
+			if (flags & JSON_INLINE)
+				return string_(sizeof(data.chars) - 1 - data.chars[sizeof(data.chars) - 1], data.chars);
+
+			return data.string;
+		}
 	};
 
-	inline bool operator==(const string& s, const string& t)
-	{
-		return s.size == t.size && 0 == strcmp(s.data, t.data);
-	}
-	inline bool operator==(const string& s, const char* t)
+	// Heap memory held by owned values: strings, arrays, bytes, the object
+	// maps and their nodes. Each thread counts its own without
+	// locks or read-modify-write, so the counters can stay on in production;
+	// define JSON_NO_ALLOC_STATS to compile them out. live is what the thread
+	// allocated less what it freed, so it goes negative on a thread that
+	// frees values built elsewhere.
+	struct alloc_stats {
+		size_t allocations;
+		size_t frees;
+		size_t bytes;  // total allocated
+		int64_t live;  // bytes still held
+		int64_t peak;  // highest live
+	};
+
+	class alloc_counter {
+		alloc_counter(const alloc_counter&);
+		alloc_counter& operator=(const alloc_counter&);
+
+		// only the owning thread writes, others may read for totals
+		struct counters {
+			std::atomic<size_t> allocations, frees, bytes;
+			std::atomic<int64_t> live, peak;
+		};
+		// Counters are never freed: a thread's slot goes back on the free list
+		// when it exits, and whatever it frees after that, e.g. statics on the
+		// main thread, lands in the shared orphan counter.
+		struct registry {
+			std::mutex m;
+			alloc_stats exited;
+			std::vector<alloc_counter*> threads, free;
+			alloc_counter* orphan;
+		};
+		// never destroyed, a check at exit may still read it
+		static registry& threads()
+		{
+			static registry* r = make_registry();
+			return *r;
+		}
+		static registry* make_registry()
+		{
+			registry* r = new registry();
+			r->exited = alloc_stats();
+			r->orphan = new alloc_counter(true);
+			r->threads.push_back(r->orphan);
+
+			return r;
+		}
+		static alloc_counter* attach()
+		{
+			registry& r = threads();
+			std::lock_guard<std::mutex> l(r.m);
+			if (r.free.empty()) {
+				r.threads.push_back(new alloc_counter(false));
+				return r.threads.back();
+			}
+			alloc_counter* a = r.free.back();
+			r.free.pop_back();
+
+			return a;
+		}
+		static void detach(alloc_counter* a)
+		{
+			registry& r = threads();
+			std::lock_guard<std::mutex> l(r.m);
+			add(r.exited, a->stats());
+			a->reset();
+			r.free.push_back(a);
+		}
+		template<class T>
+		void add(std::atomic<T>& a, T n)
+		{
+			if (shared)
+				a.fetch_add(n, std::memory_order_relaxed);
+			else
+				a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+		}
+		static void add(alloc_stats& s, const alloc_stats& t)
+		{
+			s.allocations += t.allocations;
+			s.frees += t.frees;
+			s.bytes += t.bytes;
+			s.live += t.live;
+			s.peak += t.peak;
+		}
+		explicit alloc_counter(bool shared)
+			: shared(shared)
+		{
+			reset();
+		}
+		void reset()
+		{
+			c.allocations = 0;
+			c.frees = 0;
+			c.bytes = 0;
+			c.live = 0;
+			c.peak = 0;
+		}
+	public:
+		// the calling thread's counter
+		static alloc_counter& local()
+		{
+			// trivial, so still usable while thread_locals and statics are destroyed
+			static thread_local alloc_counter* a = 0;
+			struct leave {
+				~leave()
+				{
+					detach(a);
+					a = threads().orphan;
+				}
+			};
+			if (!a) {
+				static thread_local leave e;
+				(void)e;
+				a = attach();
+			}
+
+			return *a;
+		}
+		// all threads, running and exited, peak is the sum of their peaks
+		static alloc_stats total()
+		{
+			registry& r = threads();
+			std::lock_guard<std::mutex> l(r.m);
+			alloc_stats s = r.exited;
+			for (size_t i = 0; i < r.threads.size(); ++i)
+				add(s, r.threads[i]->stats());
+
+			return s;
+		}
+
+		alloc_stats stats() const
+		{
+			alloc_stats s;
+			s.allocations = c.allocations.load(std::memory_order_relaxed);
+			s.frees = c.frees.load(std::memory_order_relaxed);
+			s.bytes = c.bytes.load(std::memory_order_relaxed);
+			s.live = c.live.load(std::memory_order_relaxed);
+			s.peak = c.peak.load(std::memory_order_relaxed);
+
+			return s;
+		}
+
+		void allocated(size_t n)
+		{
+			add(c.allocations, size_t(1));
+			add(c.bytes, n);
+			add(c.live, int64_t(n));
+			if (c.live.load(std::memory_order_relaxed) > c.peak.load(std::memory_order_relaxed))
+				c.peak.store(c.live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+		void freed(size_t n)
+		{
+			add(c.frees, size_t(1));
+			add(c.live, -int64_t(n));
+		}
+		// a scope measures from its own live, so restart peak there
+		int64_t restart_peak()
+		{
+			int64_t p = c.peak.load(std::memory_order_relaxed);
+			c.peak.store(c.live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			return p;
+		}
+		void restore_peak(int64_t p)
+		{
+			if (p > c.peak.load(std::memory_order_relaxed))
+				c.peak.store(p, std::memory_order_relaxed);
+		}
+	private:
+		counters c;
+		bool shared;
+	};
+
+	// the calling thread's counts and those of the whole process
+	inline alloc_stats thread_alloc_stats()
 	{
-		return s == string_(strlen(t), t);
+		return alloc_counter::local().stats();
 	}
-	inline bool operator<(const string& s, const string& t)
+	inline alloc_stats total_alloc_stats()
 	{
-		return strcmp(s.data, t.data) < 0;
+		return alloc_counter::total();
 	}
-	inline bool operator<(const string& s, const char* t)
+
+	// Counts on this thread since construction, e.g. for one document:
+	//	json::alloc_scope s;
+	//	json::value v = json::parse(...);
+	//	s.stats().peak; // most bytes held at once while parsing
+	// Scopes nest, peak is relative to live when the scope began.
+	class alloc_scope {
+		alloc_scope(const alloc_scope&);
+		alloc_scope& operator=(const alloc_scope&);
+	public:
+		alloc_scope()
+			: a(alloc_counter::local()), start(a.stats()), outer(a.restart_peak())
+		{ }
+		~alloc_scope()
+		{
+			a.restore_peak(outer);
+		}
+
+		alloc_stats stats() const
+		{
+			alloc_stats s = a.stats();
+			s.allocations -= start.allocations;
+			s.frees -= start.frees;
+			s.bytes -= start.bytes;
+			s.peak -= start.live;
+			s.live -= start.live;
+
+			return s;
+		}
+	private:
+		alloc_counter& a;
+		alloc_stats start;
+		int64_t outer;
+	};
+
+	// heap blocks of owned values, the caller passes the size back to free
+	inline void* allocate(size_t n)
 	{
-		return s < string_(strlen(t), t);
+		void* p = malloc(n);
+		if (!p)
+			throw std::bad_alloc();
+#ifndef JSON_NO_ALLOC_STATS
+		alloc_counter::local().allocated(n);
+#endif
+		return p;
 	}
-
-	inline bool operator==(const array& a, const array& b)
+	inline void* reallocate(void* p, size_t old, size_t n)
 	{
-		return a.size == b.size && std::equal(a.element, a.element + a.size, b.element);
+		void* q = realloc(p, n);
+		if (!q)
+			throw std::bad_alloc();
+#ifndef JSON_NO_ALLOC_STATS
+		alloc_counter& a = alloc_counter::local();
+		if (p)
+			a.freed(old);
+		a.allocated(n);
+#endif
+		return q;
 	}
-	inline bool operator<(const array& a, const array& b)
+	inline void deallocate(void* p, size_t n)
 	{
-		return std::lexicographical_compare(a.element, a.element + a.size, b.element, b.element + b.size);
+		if (!p)
+			return;
+		free(p);
+#ifndef JSON_NO_ALLOC_STATS
+		alloc_counter::local().freed(n);
+#else
+		(void)n;
+#endif
 	}
-
-	inline bool operator==(const byte& a, const byte& b)
+	// objects are created with new, only their size is counted here
+	inline void allocated(size_t n)
 	{
-		return a.size == b.size && 0 == memcmp(a.data, b.data, a.size);
+#ifndef JSON_NO_ALLOC_STATS
+		alloc_counter::local().allocated(n);
+#else
+		(void)n;
+#endif
 	}
-	inline bool operator<(const byte& a, const byte& b)
+	inline void deallocated(size_t n)
 	{
-		return std::lexicographical_compare(a.data, a.data + a.size, b.data, b.data + b.size);
+#ifndef JSON_NO_ALLOC_STATS
+		alloc_counter::local().freed(n);
+#else
+		(void)n;
+#endif
 	}
 
-	inline bool operator==(const element& e, const string& s)
+	inline memory& heap()
 	{
-		return e.type == JSON_STRING && e.data.string == s;
+		struct heap_memory : public memory {
+			void* allocate(size_t n, size_t)
+			{
+				return json::allocate(n);
+			}
+			void deallocate(void* p, size_t n, size_t)
+			{
+				json::deallocate(p, n);
+			}
+		};
+		static heap_memory h;
+
+		return h;
+	}
+
+	// Bump allocator for whole documents. Values allocated from an arena are
+	// JSON_BORROWED: destroying them is a no-op and their memory is released
+	// all at once by reset() or the destructor. Arena trees are meant to be
+	// read only; copying a value out of an arena makes an owned heap copy.
+	// Blocks come from the heap or from an upstream memory, e.g. huge pages.
+	// As a json::memory an arena never frees, values made with it that way
+	// are still destroyed one by one. Objects made in an arena take their
+	// nodes from it as well, so reset only has to finalize them for the
+	// keys too long to be held in the node.
+	class arena : public memory {
+		struct block {
+			block* next;
+			size_t size;
+		};
+		struct finalizer {
+			void (*destroy)(void*);
+			void* p;
+			finalizer* next;
+		};
+		arena(const arena&);
+		arena& operator=(const arena&);
+	public:
+		explicit arena(size_t size = 4096)
+			: up(0), head(0), fin(0), p(0), end(0), next(size)
+		{ }
+		explicit arena(json::memory& upstream, size_t size = 4096)
+			: up(&upstream), head(0), fin(0), p(0), end(0), next(size)
+		{ }
+		~arena()
+		{
+			reset();
+			release(head);
+		}
+
+		void* allocate(size_t n, size_t align = sizeof(void*)) final
+		{
+			size_t pad = (0 - reinterpret_cast<uintptr_t>(p)) & (align - 1);
+
+			if (static_cast<size_t>(end - p) < pad + n) {
+				grow(n + align);
+				pad = (0 - reinterpret_cast<uintptr_t>(p)) & (align - 1);
+			}
+
+			char* q = p + pad;
+			p = q + n;
+
+			return q;
+		}
+		void deallocate(void*, size_t, size_t = sizeof(void*)) final
+		{ }
+		// construct a T whose destructor runs on reset
+		template<class T, class... Args>
+		T* create(Args&&... args)
+		{
+			T* t = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+			finalizer* f = static_cast<finalizer*>(allocate(sizeof(finalizer)));
+
+			f->destroy = &destroy<T>;
+			f->p = t;
+			f->next = fin;
+			fin = f;
+
+			return t;
+		}
+		// run finalizers and release all but the most recent block
+		void reset()
+		{
+			for (; fin; fin = fin->next)
+				fin->destroy(fin->p);
+
+			if (head) {
+				block* b = head->next;
+				while (b) {
+					block* n = b->next;
+					release(b);
+					b = n;
+				}
+				head->next = 0;
+				p = reinterpret_cast<char*>(head + 1);
+			}
+		}
+
+	private:
+		json::memory* up; // null for the heap
+		block* head;
+		finalizer* fin;
+		char* p;
+		char* end;
+		size_t next; // size of the next block
+
+		template<class T>
+		static void destroy(void* p)
+		{
+			static_cast<T*>(p)->~T();
+		}
+		void grow(size_t n)
+		{
+			size_t size = next > n ? next : n;
+			block* b = static_cast<block*>(up ? up->allocate(sizeof(block) + size) : malloc(sizeof(block) + size));
+
+			if (!b)
+				throw std::bad_alloc();
+			b->next = head;
+			b->size = size;
+			head = b;
+			p = reinterpret_cast<char*>(b + 1);
+			end = p + size;
+			if (next < (1 << 20))
+				next *= 2;
+		}
+		void release(block* b)
+		{
+			if (b && up)
+				up->deallocate(b, sizeof(block) + b->size);
+			else
+				free(b);
+		}
+	};
+
+	//
+	// numbers
+	//
+
+	// high and low 64 bits of a*b
+	inline void multiply(uint64_t a, uint64_t b, uint64_t& hi, uint64_t& lo)
+	{
+#if defined(__SIZEOF_INT128__)
+		unsigned __int128 p = static_cast<unsigned __int128>(a)*b;
+		hi = static_cast<uint64_t>(p >> 64);
+		lo = static_cast<uint64_t>(p);
+#elif defined(_MSC_VER) && defined(_M_X64)
+		lo = _umul128(a, b, &hi);
+#else
+		const uint64_t m32 = 0xFFFFFFFFull;
+		uint64_t a1 = a >> 32, a0 = a & m32, b1 = b >> 32, b0 = b & m32;
+		uint64_t p00 = a0*b0, p01 = a0*b1, p10 = a1*b0, p11 = a1*b1;
+		uint64_t mid = (p00 >> 32) + (p01 & m32) + (p10 & m32);
+		hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+		lo = (mid << 32) | (p00 & m32);
+#endif
+	}
+	inline int leading_zeros(uint64_t u)
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long i;
+		_BitScanReverse64(&i, u);
+
+		return 63 - static_cast<int>(i);
+#elif defined(_MSC_VER)
+		int n = 0;
+		while (!(u & 0x8000000000000000ull)) {
+			u <<= 1;
+			++n;
+		}
+
+		return n;
+#else
+		return __builtin_clzll(u);
+#endif
+	}
+
+	// w*10^q rounded to the nearest double by Eisel and Lemire's algorithm,
+	// w != 0, false in the rare cases it cannot decide and for subnormals
+	inline bool eisel_lemire(uint64_t w, int q, double& d)
+	{
+		// 5^q for q = -342, ..., 308 truncated to 128 bits, high word first
+		static const uint64_t pow5[] = {
+				0xeef453d6923bd65aull, 0x113faa2906a13b3full, 0x9558b4661b6565f8ull, 0x4ac7ca59a424c507ull,
+				0xbaaee17fa23ebf76ull, 0x5d79bcf00d2df649ull, 0xe95a99df8ace6f53ull, 0xf4d82c2c107973dcull,
+				0x91d8a02bb6c10594ull, 0x79071b9b8a4be869ull, 0xb64ec836a47146f9ull, 0x9748e2826cdee284ull,
+				0xe3e27a444d8d98b7ull, 0xfd1b1b2308169b25ull, 0x8e6d8c6ab0787f72ull, 0xfe30f0f5e50e20f7ull,
+				0xb208ef855c969f4full, 0xbdbd2d335e51a935ull, 0xde8b2b66b3bc4723ull, 0xad2c788035e61382ull,
+				0x8b16fb203055ac76ull, 0x4c3bcb5021afcc31ull, 0xaddcb9e83c6b1793ull, 0xdf4abe242a1bbf3dull,
+				0xd953e8624b85dd78ull, 0xd71d6dad34a2af0dull, 0x87d4713d6f33aa6bull, 0x8672648c40e5ad68ull,
+				0xa9c98d8ccb009506ull, 0x680efdaf511f18c2ull, 0xd43bf0effdc0ba48ull, 0x0212bd1b2566def2ull,
+				0x84a57695fe98746dull, 0x014bb630f7604b57ull, 0xa5ced43b7e3e9188ull, 0x419ea3bd35385e2dull,
+				0xcf42894a5dce35eaull, 0x52064cac828675b9ull, 0x818995ce7aa0e1b2ull, 0x7343efebd1940993ull,
+				0xa1ebfb4219491a1full, 0x1014ebe6c5f90bf8ull, 0xca66fa129f9b60a6ull, 0xd41a26e077774ef6ull,
+				0xfd00b897478238d0ull, 0x8920b098955522b4ull, 0x9e20735e8cb16382ull, 0x55b46e5f5d5535b0ull,
+				0xc5a890362fddbc62ull, 0xeb2189f734aa831dull, 0xf712b443bbd52b7bull, 0xa5e9ec7501d523e4ull,
+				0x9a6bb0aa55653b2dull, 0x47b233c92125366eull, 0xc1069cd4eabe89f8ull, 0x999ec0bb696e840aull,
+				0xf148440a256e2c76ull, 0xc00670ea43ca250dull, 0x96cd2a865764dbcaull, 0x380406926a5e5728ull,
+				0xbc807527ed3e12bcull, 0xc605083704f5ecf2ull, 0xeba09271e88d976bull, 0xf7864a44c633682eull,
+				0x93445b8731587ea3ull, 0x7ab3ee6afbe0211dull, 0xb8157268fdae9e4cull, 0x5960ea05bad82964ull,
+				0xe61acf033d1a45dfull, 0x6fb92487298e33bdull, 0x8fd0c16206306babull, 0xa5d3b6d479f8e056ull,
+				0xb3c4f1ba87bc8696ull, 0x8f48a4899877186cull, 0xe0b62e2929aba83cull, 0x331acdabfe94de87ull,
+				0x8c71dcd9ba0b4925ull, 0x9ff0c08b7f1d0b14ull, 0xaf8e5410288e1b6full, 0x07ecf0ae5ee44dd9ull,
+				0xdb71e91432b1a24aull, 0xc9e82cd9f69d6150ull, 0x892731ac9faf056eull, 0xbe311c083a225cd2ull,
+				0xab70fe17c79ac6caull, 0x6dbd630a48aaf406ull, 0xd64d3d9db981787dull, 0x092cbbccdad5b108ull,
+				0x85f0468293f0eb4eull, 0x25bbf56008c58ea5ull, 0xa76c582338ed2621ull, 0xaf2af2b80af6f24eull,
+				0xd1476e2c07286faaull, 0x1af5af660db4aee1ull, 0x82cca4db847945caull, 0x50d98d9fc890ed4dull,
+				0xa37fce126597973cull, 0xe50ff107bab528a0ull, 0xcc5fc196fefd7d0cull, 0x1e53ed49a96272c8ull,
+				0xff77b1fcbebcdc4full, 0x25e8e89c13bb0f7aull, 0x9faacf3df73609b1ull, 0x77b191618c54e9acull,
+				0xc795830d75038c1dull, 0xd59df5b9ef6a2417ull, 0xf97ae3d0d2446f25ull, 0x4b0573286b44ad1dull,
+				0x9becce62836ac577ull, 0x4ee367f9430aec32ull, 0xc2e801fb244576d5ull, 0x229c41f793cda73full,
+				0xf3a20279ed56d48aull, 0x6b43527578c1110full, 0x9845418c345644d6ull, 0x830a13896b78aaa9ull,
+				0xbe5691ef416bd60cull, 0x23cc986bc656d553ull, 0xedec366b11c6cb8full, 0x2cbfbe86b7ec8aa8ull,
+				0x94b3a202eb1c3f39ull, 0x7bf7d71432f3d6a9ull, 0xb9e08a83a5e34f07ull, 0xdaf5ccd93fb0cc53ull,
+				0xe858ad248f5c22c9ull, 0xd1b3400f8f9cff68ull, 0x91376c36d99995beull, 0x23100809b9c21fa1ull,
+				0xb58547448ffffb2dull, 0xabd40a0c2832a78aull, 0xe2e69915b3fff9f9ull, 0x16c90c8f323f516cull,
+				0x8dd01fad907ffc3bull, 0xae3da7d97f6792e3ull, 0xb1442798f49ffb4aull, 0x99cd11cfdf41779cull,
+				0xdd95317f31c7fa1dull, 0x40405643d711d583ull, 0x8a7d3eef7f1cfc52ull, 0x482835ea666b2572ull,
+				0xad1c8eab5ee43b66ull, 0xda3243650005eecfull, 0xd863b256369d4a40ull, 0x90bed43e40076a82ull,
+				0x873e4f75e2224e68ull, 0x5a7744a6e804a291ull, 0xa90de3535aaae202ull, 0x711515d0a205cb36ull,
+				0xd3515c2831559a83ull, 0x0d5a5b44ca873e03ull, 0x8412d9991ed58091ull, 0xe858790afe9486c2ull,
+				0xa5178fff668ae0b6ull, 0x626e974dbe39a872ull, 0xce5d73ff402d98e3ull, 0xfb0a3d212dc8128full,
+				0x80fa687f881c7f8eull, 0x7ce66634bc9d0b99ull, 0xa139029f6a239f72ull, 0x1c1fffc1ebc44e80ull,
+				0xc987434744ac874eull, 0xa327ffb266b56220ull, 0xfbe9141915d7a922ull, 0x4bf1ff9f0062baa8ull,
+				0x9d71ac8fada6c9b5ull, 0x6f773fc3603db4a9ull, 0xc4ce17b399107c22ull, 0xcb550fb4384d21d3ull,
+				0xf6019da07f549b2bull, 0x7e2a53a146606a48ull, 0x99c102844f94e0fbull, 0x2eda7444cbfc426dull,
+				0xc0314325637a1939ull, 0xfa911155fefb5308ull, 0xf03d93eebc589f88ull, 0x793555ab7eba27caull,
+				0x96267c7535b763b5ull, 0x4bc1558b2f3458deull, 0xbbb01b9283253ca2ull, 0x9eb1aaedfb016f16ull,
+				0xea9c227723ee8bcbull, 0x465e15a979c1cadcull, 0x92a1958a7675175full, 0x0bfacd89ec191ec9ull,
+				0xb749faed14125d36ull, 0xcef980ec671f667bull, 0xe51c79a85916f484ull, 0x82b7e12780e7401aull,
+				0x8f31cc0937ae58d2ull, 0xd1b2ecb8b0908810ull, 0xb2fe3f0b8599ef07ull, 0x861fa7e6dcb4aa15ull,
+				0xdfbdcece67006ac9ull, 0x67a791e093e1d49aull, 0x8bd6a141006042bdull, 0xe0c8bb2c5c6d24e0ull,
+				0xaecc49914078536dull, 0x58fae9f773886e18ull, 0xda7f5bf590966848ull, 0xaf39a475506a899eull,
+				0x888f99797a5e012dull, 0x6d8406c952429603ull, 0xaab37fd7d8f58178ull, 0xc8e5087ba6d33b83ull,
+				0xd5605fcdcf32e1d6ull, 0xfb1e4a9a90880a64ull, 0x855c3be0a17fcd26ull, 0x5cf2eea09a55067full,
+				0xa6b34ad8c9dfc06full, 0xf42faa48c0ea481eull, 0xd0601d8efc57b08bull, 0xf13b94daf124da26ull,
+				0x823c12795db6ce57ull, 0x76c53d08d6b70858ull, 0xa2cb1717b52481edull, 0x54768c4b0c64ca6eull,
+				0xcb7ddcdda26da268ull, 0xa9942f5dcf7dfd09ull, 0xfe5d54150b090b02ull, 0xd3f93b35435d7c4cull,
+				0x9efa548d26e5a6e1ull, 0xc47bc5014a1a6dafull, 0xc6b8e9b0709f109aull, 0x359ab6419ca1091bull,
+				0xf867241c8cc6d4c0ull, 0xc30163d203c94b62ull, 0x9b407691d7fc44f8ull, 0x79e0de63425dcf1dull,
+				0xc21094364dfb5636ull, 0x985915fc12f542e4ull, 0xf294b943e17a2bc4ull, 0x3e6f5b7b17b2939dull,
+				0x979cf3ca6cec5b5aull, 0xa705992ceecf9c42ull, 0xbd8430bd08277231ull, 0x50c6ff782a838353ull,
+				0xece53cec4a314ebdull, 0xa4f8bf5635246428ull, 0x940f4613ae5ed136ull, 0x871b7795e136be99ull,
+				0xb913179899f68584ull, 0x28e2557b59846e3full, 0xe757dd7ec07426e5ull, 0x331aeada2fe589cfull,
+				0x9096ea6f3848984full, 0x3ff0d2c85def7621ull, 0xb4bca50b065abe63ull, 0x0fed077a756b53a9ull,
+				0xe1ebce4dc7f16dfbull, 0xd3e8495912c62894ull, 0x8d3360f09cf6e4bdull, 0x64712dd7abbbd95cull,
+				0xb080392cc4349decull, 0xbd8d794d96aacfb3ull, 0xdca04777f541c567ull, 0xecf0d7a0fc5583a0ull,
+				0x89e42caaf9491b60ull, 0xf41686c49db57244ull, 0xac5d37d5b79b6239ull, 0x311c2875c522ced5ull,
+				0xd77485cb25823ac7ull, 0x7d633293366b828bull, 0x86a8d39ef77164bcull, 0xae5dff9c02033197ull,
+				0xa8530886b54dbdebull, 0xd9f57f830283fdfcull, 0xd267caa862a12d66ull, 0xd072df63c324fd7bull,
+				0x8380dea93da4bc60ull, 0x4247cb9e59f71e6dull, 0xa46116538d0deb78ull, 0x52d9be85f074e608ull,
+				0xcd795be870516656ull, 0x67902e276c921f8bull, 0x806bd9714632dff6ull, 0x00ba1cd8a3db53b6ull,
+				0xa086cfcd97bf97f3ull, 0x80e8a40eccd228a4ull, 0xc8a883c0fdaf7df0ull, 0x6122cd128006b2cdull,
+				0xfad2a4b13d1b5d6cull, 0x796b805720085f81ull, 0x9cc3a6eec6311a63ull, 0xcbe3303674053bb0ull,
+				0xc3f490aa77bd60fcull, 0xbedbfc4411068a9cull, 0xf4f1b4d515acb93bull, 0xee92fb5515482d44ull,
+				0x991711052d8bf3c5ull, 0x751bdd152d4d1c4aull, 0xbf5cd54678eef0b6ull, 0xd262d45a78a0635dull,
+				0xef340a98172aace4ull, 0x86fb897116c87c34ull, 0x9580869f0e7aac0eull, 0xd45d35e6ae3d4da0ull,
+				0xbae0a846d2195712ull, 0x8974836059cca109ull, 0xe998d258869facd7ull, 0x2bd1a438703fc94bull,
+				0x91ff83775423cc06ull, 0x7b6306a34627ddcfull, 0xb67f6455292cbf08ull, 0x1a3bc84c17b1d542ull,
+				0xe41f3d6a7377eecaull, 0x20caba5f1d9e4a93ull, 0x8e938662882af53eull, 0x547eb47b7282ee9cull,
+				0xb23867fb2a35b28dull, 0xe99e619a4f23aa43ull, 0xdec681f9f4c31f31ull, 0x6405fa00e2ec94d4ull,
+				0x8b3c113c38f9f37eull, 0xde83bc408dd3dd04ull, 0xae0b158b4738705eull, 0x9624ab50b148d445ull,
+				0xd98ddaee19068c76ull, 0x3badd624dd9b0957ull, 0x87f8a8d4cfa417c9ull, 0xe54ca5d70a80e5d6ull,
+				0xa9f6d30a038d1dbcull, 0x5e9fcf4ccd211f4cull, 0xd47487cc8470652bull, 0x7647c3200069671full,
+				0x84c8d4dfd2c63f3bull, 0x29ecd9f40041e073ull, 0xa5fb0a17c777cf09ull, 0xf468107100525890ull,
+				0xcf79cc9db955c2ccull, 0x7182148d4066eeb4ull, 0x81ac1fe293d599bfull, 0xc6f14cd848405530ull,
+				0xa21727db38cb002full, 0xb8ada00e5a506a7cull, 0xca9cf1d206fdc03bull, 0xa6d90811f0e4851cull,
+				0xfd442e4688bd304aull, 0x908f4a166d1da663ull, 0x9e4a9cec15763e2eull, 0x9a598e4e043287feull,
+				0xc5dd44271ad3cdbaull, 0x40eff1e1853f29fdull, 0xf7549530e188c128ull, 0xd12bee59e68ef47cull,
+				0x9a94dd3e8cf578b9ull, 0x82bb74f8301958ceull, 0xc13a148e3032d6e7ull, 0xe36a52363c1faf01ull,
+				0xf18899b1bc3f8ca1ull, 0xdc44e6c3cb279ac1ull, 0x96f5600f15a7b7e5ull, 0x29ab103a5ef8c0b9ull,
+				0xbcb2b812db11a5deull, 0x7415d448f6b6f0e7ull, 0xebdf661791d60f56ull, 0x111b495b3464ad21ull,
+				0x936b9fcebb25c995ull, 0xcab10dd900beec34ull, 0xb84687c269ef3bfbull, 0x3d5d514f40eea742ull,
+				0xe65829b3046b0afaull, 0x0cb4a5a3112a5112ull, 0x8ff71a0fe2c2e6dcull, 0x47f0e785eaba72abull,
+				0xb3f4e093db73a093ull, 0x59ed216765690f56ull, 0xe0f218b8d25088b8ull, 0x306869c13ec3532cull,
+				0x8c974f7383725573ull, 0x1e414218c73a13fbull, 0xafbd2350644eeacfull, 0xe5d1929ef90898faull,
+				0xdbac6c247d62a583ull, 0xdf45f746b74abf39ull, 0x894bc396ce5da772ull, 0x6b8bba8c328eb783ull,
+				0xab9eb47c81f5114full, 0x066ea92f3f326564ull, 0xd686619ba27255a2ull, 0xc80a537b0efefebdull,
+				0x8613fd0145877585ull, 0xbd06742ce95f5f36ull, 0xa798fc4196e952e7ull, 0x2c48113823b73704ull,
+				0xd17f3b51fca3a7a0ull, 0xf75a15862ca504c5ull, 0x82ef85133de648c4ull, 0x9a984d73dbe722fbull,
+				0xa3ab66580d5fdaf5ull, 0xc13e60d0d2e0ebbaull, 0xcc963fee10b7d1b3ull, 0x318df905079926a8ull,
+				0xffbbcfe994e5c61full, 0xfdf17746497f7052ull, 0x9fd561f1fd0f9bd3ull, 0xfeb6ea8bedefa633ull,
+				0xc7caba6e7c5382c8ull, 0xfe64a52ee96b8fc0ull, 0xf9bd690a1b68637bull, 0x3dfdce7aa3c673b0ull,
+				0x9c1661a651213e2dull, 0x06bea10ca65c084eull, 0xc31bfa0fe5698db8ull, 0x486e494fcff30a62ull,
+				0xf3e2f893dec3f126ull, 0x5a89dba3c3efccfaull, 0x986ddb5c6b3a76b7ull, 0xf89629465a75e01cull,
+				0xbe89523386091465ull, 0xf6bbb397f1135823ull, 0xee2ba6c0678b597full, 0x746aa07ded582e2cull,
+				0x94db483840b717efull, 0xa8c2a44eb4571cdcull, 0xba121a4650e4ddebull, 0x92f34d62616ce413ull,
+				0xe896a0d7e51e1566ull, 0x77b020baf9c81d17ull, 0x915e2486ef32cd60ull, 0x0ace1474dc1d122eull,
+				0xb5b5ada8aaff80b8ull, 0x0d819992132456baull, 0xe3231912d5bf60e6ull, 0x10e1fff697ed6c69ull,
+				0x8df5efabc5979c8full, 0xca8d3ffa1ef463c1ull, 0xb1736b96b6fd83b3ull, 0xbd308ff8a6b17cb2ull,
+				0xddd0467c64bce4a0ull, 0xac7cb3f6d05ddbdeull, 0x8aa22c0dbef60ee4ull, 0x6bcdf07a423aa96bull,
+				0xad4ab7112eb3929dull, 0x86c16c98d2c953c6ull, 0xd89d64d57a607744ull, 0xe871c7bf077ba8b7ull,
+				0x87625f056c7c4a8bull, 0x11471cd764ad4972ull, 0xa93af6c6c79b5d2dull, 0xd598e40d3dd89bcfull,
+				0xd389b47879823479ull, 0x4aff1d108d4ec2c3ull, 0x843610cb4bf160cbull, 0xcedf722a585139baull,
+				0xa54394fe1eedb8feull, 0xc2974eb4ee658828ull, 0xce947a3da6a9273eull, 0x733d226229feea32ull,
+				0x811ccc668829b887ull, 0x0806357d5a3f525full, 0xa163ff802a3426a8ull, 0xca07c2dcb0cf26f7ull,
+				0xc9bcff6034c13052ull, 0xfc89b393dd02f0b5ull, 0xfc2c3f3841f17c67ull, 0xbbac2078d443ace2ull,
+				0x9d9ba7832936edc0ull, 0xd54b944b84aa4c0dull, 0xc5029163f384a931ull, 0x0a9e795e65d4df11ull,
+				0xf64335bcf065d37dull, 0x4d4617b5ff4a16d5ull, 0x99ea0196163fa42eull, 0x504bced1bf8e4e45ull,
+				0xc06481fb9bcf8d39ull, 0xe45ec2862f71e1d6ull, 0xf07da27a82c37088ull, 0x5d767327bb4e5a4cull,
+				0x964e858c91ba2655ull, 0x3a6a07f8d510f86full, 0xbbe226efb628afeaull, 0x890489f70a55368bull,
+				0xeadab0aba3b2dbe5ull, 0x2b45ac74ccea842eull, 0x92c8ae6b464fc96full, 0x3b0b8bc90012929dull,
+				0xb77ada0617e3bbcbull, 0x09ce6ebb40173744ull, 0xe55990879ddcaabdull, 0xcc420a6a101d0515ull,
+				0x8f57fa54c2a9eab6ull, 0x9fa946824a12232dull, 0xb32df8e9f3546564ull, 0x47939822dc96abf9ull,
+				0xdff9772470297ebdull, 0x59787e2b93bc56f7ull, 0x8bfbea76c619ef36ull, 0x57eb4edb3c55b65aull,
+				0xaefae51477a06b03ull, 0xede622920b6b23f1ull, 0xdab99e59958885c4ull, 0xe95fab368e45ecedull,
+				0x88b402f7fd75539bull, 0x11dbcb0218ebb414ull, 0xaae103b5fcd2a881ull, 0xd652bdc29f26a119ull,
+				0xd59944a37c0752a2ull, 0x4be76d3346f0495full, 0x857fcae62d8493a5ull, 0x6f70a4400c562ddbull,
+				0xa6dfbd9fb8e5b88eull, 0xcb4ccd500f6bb952ull, 0xd097ad07a71f26b2ull, 0x7e2000a41346a7a7ull,
+				0x825ecc24c873782full, 0x8ed400668c0c28c8ull, 0xa2f67f2dfa90563bull, 0x728900802f0f32faull,
+				0xcbb41ef979346bcaull, 0x4f2b40a03ad2ffb9ull, 0xfea126b7d78186bcull, 0xe2f610c84987bfa8ull,
+				0x9f24b832e6b0f436ull, 0x0dd9ca7d2df4d7c9ull, 0xc6ede63fa05d3143ull, 0x91503d1c79720dbbull,
+				0xf8a95fcf88747d94ull, 0x75a44c6397ce912aull, 0x9b69dbe1b548ce7cull, 0xc986afbe3ee11abaull,
+				0xc24452da229b021bull, 0xfbe85badce996168ull, 0xf2d56790ab41c2a2ull, 0xfae27299423fb9c3ull,
+				0x97c560ba6b0919a5ull, 0xdccd879fc967d41aull, 0xbdb6b8e905cb600full, 0x5400e987bbc1c920ull,
+				0xed246723473e3813ull, 0x290123e9aab23b68ull, 0x9436c0760c86e30bull, 0xf9a0b6720aaf6521ull,
+				0xb94470938fa89bceull, 0xf808e40e8d5b3e69ull, 0xe7958cb87392c2c2ull, 0xb60b1d1230b20e04ull,
+				0x90bd77f3483bb9b9ull, 0xb1c6f22b5e6f48c2ull, 0xb4ecd5f01a4aa828ull, 0x1e38aeb6360b1af3ull,
+				0xe2280b6c20dd5232ull, 0x25c6da63c38de1b0ull, 0x8d590723948a535full, 0x579c487e5a38ad0eull,
+				0xb0af48ec79ace837ull, 0x2d835a9df0c6d851ull, 0xdcdb1b2798182244ull, 0xf8e431456cf88e65ull,
+				0x8a08f0f8bf0f156bull, 0x1b8e9ecb641b58ffull, 0xac8b2d36eed2dac5ull, 0xe272467e3d222f3full,
+				0xd7adf884aa879177ull, 0x5b0ed81dcc6abb0full, 0x86ccbb52ea94baeaull, 0x98e947129fc2b4e9ull,
+				0xa87fea27a539e9a5ull, 0x3f2398d747b36224ull, 0xd29fe4b18e88640eull, 0x8eec7f0d19a03aadull,
+				0x83a3eeeef9153e89ull, 0x1953cf68300424acull, 0xa48ceaaab75a8e2bull, 0x5fa8c3423c052dd7ull,
+				0xcdb02555653131b6ull, 0x3792f412cb06794dull, 0x808e17555f3ebf11ull, 0xe2bbd88bbee40bd0ull,
+				0xa0b19d2ab70e6ed6ull, 0x5b6aceaeae9d0ec4ull, 0xc8de047564d20a8bull, 0xf245825a5a445275ull,
+				0xfb158592be068d2eull, 0xeed6e2f0f0d56712ull, 0x9ced737bb6c4183dull, 0x55464dd69685606bull,
+				0xc428d05aa4751e4cull, 0xaa97e14c3c26b886ull, 0xf53304714d9265dfull, 0xd53dd99f4b3066a8ull,
+				0x993fe2c6d07b7fabull, 0xe546a8038efe4029ull, 0xbf8fdb78849a5f96ull, 0xde98520472bdd033ull,
+				0xef73d256a5c0f77cull, 0x963e66858f6d4440ull, 0x95a8637627989aadull, 0xdde7001379a44aa8ull,
+				0xbb127c53b17ec159ull, 0x5560c018580d5d52ull, 0xe9d71b689dde71afull, 0xaab8f01e6e10b4a6ull,
+				0x9226712162ab070dull, 0xcab3961304ca70e8ull, 0xb6b00d69bb55c8d1ull, 0x3d607b97c5fd0d22ull,
+				0xe45c10c42a2b3b05ull, 0x8cb89a7db77c506aull, 0x8eb98a7a9a5b04e3ull, 0x77f3608e92adb242ull,
+				0xb267ed1940f1c61cull, 0x55f038b237591ed3ull, 0xdf01e85f912e37a3ull, 0x6b6c46dec52f6688ull,
+				0x8b61313bbabce2c6ull, 0x2323ac4b3b3da015ull, 0xae397d8aa96c1b77ull, 0xabec975e0a0d081aull,
+				0xd9c7dced53c72255ull, 0x96e7bd358c904a21ull, 0x881cea14545c7575ull, 0x7e50d64177da2e54ull,
+				0xaa242499697392d2ull, 0xdde50bd1d5d0b9e9ull, 0xd4ad2dbfc3d07787ull, 0x955e4ec64b44e864ull,
+				0x84ec3c97da624ab4ull, 0xbd5af13bef0b113eull, 0xa6274bbdd0fadd61ull, 0xecb1ad8aeacdd58eull,
+				0xcfb11ead453994baull, 0x67de18eda5814af2ull, 0x81ceb32c4b43fcf4ull, 0x80eacf948770ced7ull,
+				0xa2425ff75e14fc31ull, 0xa1258379a94d028dull, 0xcad2f7f5359a3b3eull, 0x096ee45813a04330ull,
+				0xfd87b5f28300ca0dull, 0x8bca9d6e188853fcull, 0x9e74d1b791e07e48ull, 0x775ea264cf55347eull,
+				0xc612062576589ddaull, 0x95364afe032a819eull, 0xf79687aed3eec551ull, 0x3a83ddbd83f52205ull,
+				0x9abe14cd44753b52ull, 0xc4926a9672793543ull, 0xc16d9a0095928a27ull, 0x75b7053c0f178294ull,
+				0xf1c90080baf72cb1ull, 0x5324c68b12dd6339ull, 0x971da05074da7beeull, 0xd3f6fc16ebca5e04ull,
+				0xbce5086492111aeaull, 0x88f4bb1ca6bcf585ull, 0xec1e4a7db69561a5ull, 0x2b31e9e3d06c32e6ull,
+				0x9392ee8e921d5d07ull, 0x3aff322e62439fd0ull, 0xb877aa3236a4b449ull, 0x09befeb9fad487c3ull,
+				0xe69594bec44de15bull, 0x4c2ebe687989a9b4ull, 0x901d7cf73ab0acd9ull, 0x0f9d37014bf60a11ull,
+				0xb424dc35095cd80full, 0x538484c19ef38c95ull, 0xe12e13424bb40e13ull, 0x2865a5f206b06fbaull,
+				0x8cbccc096f5088cbull, 0xf93f87b7442e45d4ull, 0xafebff0bcb24aafeull, 0xf78f69a51539d749ull,
+				0xdbe6fecebdedd5beull, 0xb573440e5a884d1cull, 0x89705f4136b4a597ull, 0x31680a88f8953031ull,
+				0xabcc77118461cefcull, 0xfdc20d2b36ba7c3eull, 0xd6bf94d5e57a42bcull, 0x3d32907604691b4dull,
+				0x8637bd05af6c69b5ull, 0xa63f9a49c2c1b110ull, 0xa7c5ac471b478423ull, 0x0fcf80dc33721d54ull,
+				0xd1b71758e219652bull, 0xd3c36113404ea4a9ull, 0x83126e978d4fdf3bull, 0x645a1cac083126eaull,
+				0xa3d70a3d70a3d70aull, 0x3d70a3d70a3d70a4ull, 0xccccccccccccccccull, 0xcccccccccccccccdull,
+				0x8000000000000000ull, 0x0000000000000000ull, 0xa000000000000000ull, 0x0000000000000000ull,
+				0xc800000000000000ull, 0x0000000000000000ull, 0xfa00000000000000ull, 0x0000000000000000ull,
+				0x9c40000000000000ull, 0x0000000000000000ull, 0xc350000000000000ull, 0x0000000000000000ull,
+				0xf424000000000000ull, 0x0000000000000000ull, 0x9896800000000000ull, 0x0000000000000000ull,
+				0xbebc200000000000ull, 0x0000000000000000ull, 0xee6b280000000000ull, 0x0000000000000000ull,
+				0x9502f90000000000ull, 0x0000000000000000ull, 0xba43b74000000000ull, 0x0000000000000000ull,
+				0xe8d4a51000000000ull, 0x0000000000000000ull, 0x9184e72a00000000ull, 0x0000000000000000ull,
+				0xb5e620f480000000ull, 0x0000000000000000ull, 0xe35fa931a0000000ull, 0x0000000000000000ull,
+				0x8e1bc9bf04000000ull, 0x0000000000000000ull, 0xb1a2bc2ec5000000ull, 0x0000000000000000ull,
+				0xde0b6b3a76400000ull, 0x0000000000000000ull, 0x8ac7230489e80000ull, 0x0000000000000000ull,
+				0xad78ebc5ac620000ull, 0x0000000000000000ull, 0xd8d726b7177a8000ull, 0x0000000000000000ull,
+				0x878678326eac9000ull, 0x0000000000000000ull, 0xa968163f0a57b400ull, 0x0000000000000000ull,
+				0xd3c21bcecceda100ull, 0x0000000000000000ull, 0x84595161401484a0ull, 0x0000000000000000ull,
+				0xa56fa5b99019a5c8ull, 0x0000000000000000ull, 0xcecb8f27f4200f3aull, 0x0000000000000000ull,
+				0x813f3978f8940984ull, 0x4000000000000000ull, 0xa18f07d736b90be5ull, 0x5000000000000000ull,
+				0xc9f2c9cd04674edeull, 0xa400000000000000ull, 0xfc6f7c4045812296ull, 0x4d00000000000000ull,
+				0x9dc5ada82b70b59dull, 0xf020000000000000ull, 0xc5371912364ce305ull, 0x6c28000000000000ull,
+				0xf684df56c3e01bc6ull, 0xc732000000000000ull, 0x9a130b963a6c115cull, 0x3c7f400000000000ull,
+				0xc097ce7bc90715b3ull, 0x4b9f100000000000ull, 0xf0bdc21abb48db20ull, 0x1e86d40000000000ull,
+				0x96769950b50d88f4ull, 0x1314448000000000ull, 0xbc143fa4e250eb31ull, 0x17d955a000000000ull,
+				0xeb194f8e1ae525fdull, 0x5dcfab0800000000ull, 0x92efd1b8d0cf37beull, 0x5aa1cae500000000ull,
+				0xb7abc627050305adull, 0xf14a3d9e40000000ull, 0xe596b7b0c643c719ull, 0x6d9ccd05d0000000ull,
+				0x8f7e32ce7bea5c6full, 0xe4820023a2000000ull, 0xb35dbf821ae4f38bull, 0xdda2802c8a800000ull,
+				0xe0352f62a19e306eull, 0xd50b2037ad200000ull, 0x8c213d9da502de45ull, 0x4526f422cc340000ull,
+				0xaf298d050e4395d6ull, 0x9670b12b7f410000ull, 0xdaf3f04651d47b4cull, 0x3c0cdd765f114000ull,
+				0x88d8762bf324cd0full, 0xa5880a69fb6ac800ull, 0xab0e93b6efee0053ull, 0x8eea0d047a457a00ull,
+				0xd5d238a4abe98068ull, 0x72a4904598d6d880ull, 0x85a36366eb71f041ull, 0x47a6da2b7f864750ull,
+				0xa70c3c40a64e6c51ull, 0x999090b65f67d924ull, 0xd0cf4b50cfe20765ull, 0xfff4b4e3f741cf6dull,
+				0x82818f1281ed449full, 0xbff8f10e7a8921a4ull, 0xa321f2d7226895c7ull, 0xaff72d52192b6a0dull,
+				0xcbea6f8ceb02bb39ull, 0x9bf4f8a69f764490ull, 0xfee50b7025c36a08ull, 0x02f236d04753d5b4ull,
+				0x9f4f2726179a2245ull, 0x01d762422c946590ull, 0xc722f0ef9d80aad6ull, 0x424d3ad2b7b97ef5ull,
+				0xf8ebad2b84e0d58bull, 0xd2e0898765a7deb2ull, 0x9b934c3b330c8577ull, 0x63cc55f49f88eb2full,
+				0xc2781f49ffcfa6d5ull, 0x3cbf6b71c76b25fbull, 0xf316271c7fc3908aull, 0x8bef464e3945ef7aull,
+				0x97edd871cfda3a56ull, 0x97758bf0e3cbb5acull, 0xbde94e8e43d0c8ecull, 0x3d52eeed1cbea317ull,
+				0xed63a231d4c4fb27ull, 0x4ca7aaa863ee4bddull, 0x945e455f24fb1cf8ull, 0x8fe8caa93e74ef6aull,
+				0xb975d6b6ee39e436ull, 0xb3e2fd538e122b44ull, 0xe7d34c64a9c85d44ull, 0x60dbbca87196b616ull,
+				0x90e40fbeea1d3a4aull, 0xbc8955e946fe31cdull, 0xb51d13aea4a488ddull, 0x6babab6398bdbe41ull,
+				0xe264589a4dcdab14ull, 0xc696963c7eed2dd1ull, 0x8d7eb76070a08aecull, 0xfc1e1de5cf543ca2ull,
+				0xb0de65388cc8ada8ull, 0x3b25a55f43294bcbull, 0xdd15fe86affad912ull, 0x49ef0eb713f39ebeull,
+				0x8a2dbf142dfcc7abull, 0x6e3569326c784337ull, 0xacb92ed9397bf996ull, 0x49c2c37f07965404ull,
+				0xd7e77a8f87daf7fbull, 0xdc33745ec97be906ull, 0x86f0ac99b4e8dafdull, 0x69a028bb3ded71a3ull,
+				0xa8acd7c0222311bcull, 0xc40832ea0d68ce0cull, 0xd2d80db02aabd62bull, 0xf50a3fa490c30190ull,
+				0x83c7088e1aab65dbull, 0x792667c6da79e0faull, 0xa4b8cab1a1563f52ull, 0x577001b891185938ull,
+				0xcde6fd5e09abcf26ull, 0xed4c0226b55e6f86ull, 0x80b05e5ac60b6178ull, 0x544f8158315b05b4ull,
+				0xa0dc75f1778e39d6ull, 0x696361ae3db1c721ull, 0xc913936dd571c84cull, 0x03bc3a19cd1e38e9ull,
+				0xfb5878494ace3a5full, 0x04ab48a04065c723ull, 0x9d174b2dcec0e47bull, 0x62eb0d64283f9c76ull,
+				0xc45d1df942711d9aull, 0x3ba5d0bd324f8394ull, 0xf5746577930d6500ull, 0xca8f44ec7ee36479ull,
+				0x9968bf6abbe85f20ull, 0x7e998b13cf4e1ecbull, 0xbfc2ef456ae276e8ull, 0x9e3fedd8c321a67eull,
+				0xefb3ab16c59b14a2ull, 0xc5cfe94ef3ea101eull, 0x95d04aee3b80ece5ull, 0xbba1f1d158724a12ull,
+				0xbb445da9ca61281full, 0x2a8a6e45ae8edc97ull, 0xea1575143cf97226ull, 0xf52d09d71a3293bdull,
+				0x924d692ca61be758ull, 0x593c2626705f9c56ull, 0xb6e0c377cfa2e12eull, 0x6f8b2fb00c77836cull,
+				0xe498f455c38b997aull, 0x0b6dfb9c0f956447ull, 0x8edf98b59a373fecull, 0x4724bd4189bd5eacull,
+				0xb2977ee300c50fe7ull, 0x58edec91ec2cb657ull, 0xdf3d5e9bc0f653e1ull, 0x2f2967b66737e3edull,
+				0x8b865b215899f46cull, 0xbd79e0d20082ee74ull, 0xae67f1e9aec07187ull, 0xecd8590680a3aa11ull,
+				0xda01ee641a708de9ull, 0xe80e6f4820cc9495ull, 0x884134fe908658b2ull, 0x3109058d147fdcddull,
+				0xaa51823e34a7eedeull, 0xbd4b46f0599fd415ull, 0xd4e5e2cdc1d1ea96ull, 0x6c9e18ac7007c91aull,
+				0x850fadc09923329eull, 0x03e2cf6bc604ddb0ull, 0xa6539930bf6bff45ull, 0x84db8346b786151cull,
+				0xcfe87f7cef46ff16ull, 0xe612641865679a63ull, 0x81f14fae158c5f6eull, 0x4fcb7e8f3f60c07eull,
+				0xa26da3999aef7749ull, 0xe3be5e330f38f09dull, 0xcb090c8001ab551cull, 0x5cadf5bfd3072cc5ull,
+				0xfdcb4fa002162a63ull, 0x73d9732fc7c8f7f6ull, 0x9e9f11c4014dda7eull, 0x2867e7fddcdd9afaull,
+				0xc646d63501a1511dull, 0xb281e1fd541501b8ull, 0xf7d88bc24209a565ull, 0x1f225a7ca91a4226ull,
+				0x9ae757596946075full, 0x3375788de9b06958ull, 0xc1a12d2fc3978937ull, 0x0052d6b1641c83aeull,
+				0xf209787bb47d6b84ull, 0xc0678c5dbd23a49aull, 0x9745eb4d50ce6332ull, 0xf840b7ba963646e0ull,
+				0xbd176620a501fbffull, 0xb650e5a93bc3d898ull, 0xec5d3fa8ce427affull, 0xa3e51f138ab4cebeull,
+				0x93ba47c980e98cdfull, 0xc66f336c36b10137ull, 0xb8a8d9bbe123f017ull, 0xb80b0047445d4184ull,
+				0xe6d3102ad96cec1dull, 0xa60dc059157491e5ull, 0x9043ea1ac7e41392ull, 0x87c89837ad68db2full,
+				0xb454e4a179dd1877ull, 0x29babe4598c311fbull, 0xe16a1dc9d8545e94ull, 0xf4296dd6fef3d67aull,
+				0x8ce2529e2734bb1dull, 0x1899e4a65f58660cull, 0xb01ae745b101e9e4ull, 0x5ec05dcff72e7f8full,
+				0xdc21a1171d42645dull, 0x76707543f4fa1f73ull, 0x899504ae72497ebaull, 0x6a06494a791c53a8ull,
+				0xabfa45da0edbde69ull, 0x0487db9d17636892ull, 0xd6f8d7509292d603ull, 0x45a9d2845d3c42b6ull,
+				0x865b86925b9bc5c2ull, 0x0b8a2392ba45a9b2ull, 0xa7f26836f282b732ull, 0x8e6cac7768d7141eull,
+				0xd1ef0244af2364ffull, 0x3207d795430cd926ull, 0x8335616aed761f1full, 0x7f44e6bd49e807b8ull,
+				0xa402b9c5a8d3a6e7ull, 0x5f16206c9c6209a6ull, 0xcd036837130890a1ull, 0x36dba887c37a8c0full,
+				0x802221226be55a64ull, 0xc2494954da2c9789ull, 0xa02aa96b06deb0fdull, 0xf2db9baa10b7bd6cull,
+				0xc83553c5c8965d3dull, 0x6f92829494e5acc7ull, 0xfa42a8b73abbf48cull, 0xcb772339ba1f17f9ull,
+				0x9c69a97284b578d7ull, 0xff2a760414536efbull, 0xc38413cf25e2d70dull, 0xfef5138519684abaull,
+				0xf46518c2ef5b8cd1ull, 0x7eb258665fc25d69ull, 0x98bf2f79d5993802ull, 0xef2f773ffbd97a61ull,
+				0xbeeefb584aff8603ull, 0xaafb550ffacfd8faull, 0xeeaaba2e5dbf6784ull, 0x95ba2a53f983cf38ull,
+				0x952ab45cfa97a0b2ull, 0xdd945a747bf26183ull, 0xba756174393d88dfull, 0x94f971119aeef9e4ull,
+				0xe912b9d1478ceb17ull, 0x7a37cd5601aab85dull, 0x91abb422ccb812eeull, 0xac62e055c10ab33aull,
+				0xb616a12b7fe617aaull, 0x577b986b314d6009ull, 0xe39c49765fdf9d94ull, 0xed5a7e85fda0b80bull,
+				0x8e41ade9fbebc27dull, 0x14588f13be847307ull, 0xb1d219647ae6b31cull, 0x596eb2d8ae258fc8ull,
+				0xde469fbd99a05fe3ull, 0x6fca5f8ed9aef3bbull, 0x8aec23d680043beeull, 0x25de7bb9480d5854ull,
+				0xada72ccc20054ae9ull, 0xaf561aa79a10ae6aull, 0xd910f7ff28069da4ull, 0x1b2ba1518094da04ull,
+				0x87aa9aff79042286ull, 0x90fb44d2f05d0842ull, 0xa99541bf57452b28ull, 0x353a1607ac744a53ull,
+				0xd3fa922f2d1675f2ull, 0x42889b8997915ce8ull, 0x847c9b5d7c2e09b7ull, 0x69956135febada11ull,
+				0xa59bc234db398c25ull, 0x43fab9837e699095ull, 0xcf02b2c21207ef2eull, 0x94f967e45e03f4bbull,
+				0x8161afb94b44f57dull, 0x1d1be0eebac278f5ull, 0xa1ba1ba79e1632dcull, 0x6462d92a69731732ull,
+				0xca28a291859bbf93ull, 0x7d7b8f7503cfdcfeull, 0xfcb2cb35e702af78ull, 0x5cda735244c3d43eull,
+				0x9defbf01b061adabull, 0x3a0888136afa64a7ull, 0xc56baec21c7a1916ull, 0x088aaa1845b8fdd0ull,
+				0xf6c69a72a3989f5bull, 0x8aad549e57273d45ull, 0x9a3c2087a63f6399ull, 0x36ac54e2f678864bull,
+				0xc0cb28a98fcf3c7full, 0x84576a1bb416a7ddull, 0xf0fdf2d3f3c30b9full, 0x656d44a2a11c51d5ull,
+				0x969eb7c47859e743ull, 0x9f644ae5a4b1b325ull, 0xbc4665b596706114ull, 0x873d5d9f0dde1feeull,
+				0xeb57ff22fc0c7959ull, 0xa90cb506d155a7eaull, 0x9316ff75dd87cbd8ull, 0x09a7f12442d588f2ull,
+				0xb7dcbf5354e9beceull, 0x0c11ed6d538aeb2full, 0xe5d3ef282a242e81ull, 0x8f1668c8a86da5faull,
+				0x8fa475791a569d10ull, 0xf96e017d694487bcull, 0xb38d92d760ec4455ull, 0x37c981dcc395a9acull,
+				0xe070f78d3927556aull, 0x85bbe253f47b1417ull, 0x8c469ab843b89562ull, 0x93956d7478ccec8eull,
+				0xaf58416654a6babbull, 0x387ac8d1970027b2ull, 0xdb2e51bfe9d0696aull, 0x06997b05fcc0319eull,
+				0x88fcf317f22241e2ull, 0x441fece3bdf81f03ull, 0xab3c2fddeeaad25aull, 0xd527e81cad7626c3ull,
+				0xd60b3bd56a5586f1ull, 0x8a71e223d8d3b074ull, 0x85c7056562757456ull, 0xf6872d5667844e49ull,
+				0xa738c6bebb12d16cull, 0xb428f8ac016561dbull, 0xd106f86e69d785c7ull, 0xe13336d701beba52ull,
+				0x82a45b450226b39cull, 0xecc0024661173473ull, 0xa34d721642b06084ull, 0x27f002d7f95d0190ull,
+				0xcc20ce9bd35c78a5ull, 0x31ec038df7b441f4ull, 0xff290242c83396ceull, 0x7e67047175a15271ull,
+				0x9f79a169bd203e41ull, 0x0f0062c6e984d386ull, 0xc75809c42c684dd1ull, 0x52c07b78a3e60868ull,
+				0xf92e0c3537826145ull, 0xa7709a56ccdf8a82ull, 0x9bbcc7a142b17ccbull, 0x88a66076400bb691ull,
+				0xc2abf989935ddbfeull, 0x6acff893d00ea435ull, 0xf356f7ebf83552feull, 0x0583f6b8c4124d43ull,
+				0x98165af37b2153deull, 0xc3727a337a8b704aull, 0xbe1bf1b059e9a8d6ull, 0x744f18c0592e4c5cull,
+				0xeda2ee1c7064130cull, 0x1162def06f79df73ull, 0x9485d4d1c63e8be7ull, 0x8addcb5645ac2ba8ull,
+				0xb9a74a0637ce2ee1ull, 0x6d953e2bd7173692ull, 0xe8111c87c5c1ba99ull, 0xc8fa8db6ccdd0437ull,
+				0x910ab1d4db9914a0ull, 0x1d9c9892400a22a2ull, 0xb54d5e4a127f59c8ull, 0x2503beb6d00cab4bull,
+				0xe2a0b5dc971f303aull, 0x2e44ae64840fd61dull, 0x8da471a9de737e24ull, 0x5ceaecfed289e5d2ull,
+				0xb10d8e1456105dadull, 0x7425a83e872c5f47ull, 0xdd50f1996b947518ull, 0xd12f124e28f77719ull,
+				0x8a5296ffe33cc92full, 0x82bd6b70d99aaa6full, 0xace73cbfdc0bfb7bull, 0x636cc64d1001550bull,
+				0xd8210befd30efa5aull, 0x3c47f7e05401aa4eull, 0x8714a775e3e95c78ull, 0x65acfaec34810a71ull,
+				0xa8d9d1535ce3b396ull, 0x7f1839a741a14d0dull, 0xd31045a8341ca07cull, 0x1ede48111209a050ull,
+				0x83ea2b892091e44dull, 0x934aed0aab460432ull, 0xa4e4b66b68b65d60ull, 0xf81da84d5617853full,
+				0xce1de40642e3f4b9ull, 0x36251260ab9d668eull, 0x80d2ae83e9ce78f3ull, 0xc1d72b7c6b426019ull,
+				0xa1075a24e4421730ull, 0xb24cf65b8612f81full, 0xc94930ae1d529cfcull, 0xdee033f26797b627ull,
+				0xfb9b7cd9a4a7443cull, 0x169840ef017da3b1ull, 0x9d412e0806e88aa5ull, 0x8e1f289560ee864eull,
+				0xc491798a08a2ad4eull, 0xf1a6f2bab92a27e2ull, 0xf5b5d7ec8acb58a2ull, 0xae10af696774b1dbull,
+				0x9991a6f3d6bf1765ull, 0xacca6da1e0a8ef29ull, 0xbff610b0cc6edd3full, 0x17fd090a58d32af3ull,
+				0xeff394dcff8a948eull, 0xddfc4b4cef07f5b0ull, 0x95f83d0a1fb69cd9ull, 0x4abdaf101564f98eull,
+				0xbb764c4ca7a4440full, 0x9d6d1ad41abe37f1ull, 0xea53df5fd18d5513ull, 0x84c86189216dc5edull,
+				0x92746b9be2f8552cull, 0x32fd3cf5b4e49bb4ull, 0xb7118682dbb66a77ull, 0x3fbc8c33221dc2a1ull,
+				0xe4d5e82392a40515ull, 0x0fabaf3feaa5334aull, 0x8f05b1163ba6832dull, 0x29cb4d87f2a7400eull,
+				0xb2c71d5bca9023f8ull, 0x743e20e9ef511012ull, 0xdf78e4b2bd342cf6ull, 0x914da9246b255416ull,
+				0x8bab8eefb6409c1aull, 0x1ad089b6c2f7548eull, 0xae9672aba3d0c320ull, 0xa184ac2473b529b1ull,
+				0xda3c0f568cc4f3e8ull, 0xc9e5d72d90a2741eull, 0x8865899617fb1871ull, 0x7e2fa67c7a658892ull,
+				0xaa7eebfb9df9de8dull, 0xddbb901b98feeab7ull, 0xd51ea6fa85785631ull, 0x552a74227f3ea565ull,
+				0x8533285c936b35deull, 0xd53a88958f87275full, 0xa67ff273b8460356ull, 0x8a892abaf368f137ull,
+				0xd01fef10a657842cull, 0x2d2b7569b0432d85ull, 0x8213f56a67f6b29bull, 0x9c3b29620e29fc73ull,
+				0xa298f2c501f45f42ull, 0x8349f3ba91b47b8full, 0xcb3f2f7642717713ull, 0x241c70a936219a73ull,
+				0xfe0efb53d30dd4d7ull, 0xed238cd383aa0110ull, 0x9ec95d1463e8a506ull, 0xf4363804324a40aaull,
+				0xc67bb4597ce2ce48ull, 0xb143c6053edcd0d5ull, 0xf81aa16fdc1b81daull, 0xdd94b7868e94050aull,
+				0x9b10a4e5e9913128ull, 0xca7cf2b4191c8326ull, 0xc1d4ce1f63f57d72ull, 0xfd1c2f611f63a3f0ull,
+				0xf24a01a73cf2dccfull, 0xbc633b39673c8cecull, 0x976e41088617ca01ull, 0xd5be0503e085d813ull,
+				0xbd49d14aa79dbc82ull, 0x4b2d8644d8a74e18ull, 0xec9c459d51852ba2ull, 0xddf8e7d60ed1219eull,
+				0x93e1ab8252f33b45ull, 0xcabb90e5c942b503ull, 0xb8da1662e7b00a17ull, 0x3d6a751f3b936243ull,
+				0xe7109bfba19c0c9dull, 0x0cc512670a783ad4ull, 0x906a617d450187e2ull, 0x27fb2b80668b24c5ull,
+				0xb484f9dc9641e9daull, 0xb1f9f660802dedf6ull, 0xe1a63853bbd26451ull, 0x5e7873f8a0396973ull,
+				0x8d07e33455637eb2ull, 0xdb0b487b6423e1e8ull, 0xb049dc016abc5e5full, 0x91ce1a9a3d2cda62ull,
+				0xdc5c5301c56b75f7ull, 0x7641a140cc7810fbull, 0x89b9b3e11b6329baull, 0xa9e904c87fcb0a9dull,
+				0xac2820d9623bf429ull, 0x546345fa9fbdcd44ull, 0xd732290fbacaf133ull, 0xa97c177947ad4095ull,
+				0x867f59a9d4bed6c0ull, 0x49ed8eabcccc485dull, 0xa81f301449ee8c70ull, 0x5c68f256bfff5a74ull,
+				0xd226fc195c6a2f8cull, 0x73832eec6fff3111ull, 0x83585d8fd9c25db7ull, 0xc831fd53c5ff7eabull,
+				0xa42e74f3d032f525ull, 0xba3e7ca8b77f5e55ull, 0xcd3a1230c43fb26full, 0x28ce1bd2e55f35ebull,
+				0x80444b5e7aa7cf85ull, 0x7980d163cf5b81b3ull, 0xa0555e361951c366ull, 0xd7e105bcc332621full,
+				0xc86ab5c39fa63440ull, 0x8dd9472bf3fefaa7ull, 0xfa856334878fc150ull, 0xb14f98f6f0feb951ull,
+				0x9c935e00d4b9d8d2ull, 0x6ed1bf9a569f33d3ull, 0xc3b8358109e84f07ull, 0x0a862f80ec4700c8ull,
+				0xf4a642e14c6262c8ull, 0xcd27bb612758c0faull, 0x98e7e9cccfbd7dbdull, 0x8038d51cb897789cull,
+				0xbf21e44003acdd2cull, 0xe0470a63e6bd56c3ull, 0xeeea5d5004981478ull, 0x1858ccfce06cac74ull,
+				0x95527a5202df0ccbull, 0x0f37801e0c43ebc8ull, 0xbaa718e68396cffdull, 0xd30560258f54e6baull,
+				0xe950df20247c83fdull, 0x47c6b82ef32a2069ull, 0x91d28b7416cdd27eull, 0x4cdc331d57fa5441ull,
+				0xb6472e511c81471dull, 0xe0133fe4adf8e952ull, 0xe3d8f9e563a198e5ull, 0x58180fddd97723a6ull,
+				0x8e679c2f5e44ff8full, 0x570f09eaa7ea7648ull
+		};
+
+		if (q < -342) {
+			d = 0;
+			return true;
+		}
+		if (q > 308) {
+			d = HUGE_VAL;
+			return true;
+		}
+
+		int lz = leading_zeros(w);
+		const uint64_t* p = pow5 + 2*(q + 342);
+		uint64_t hi, lo;
+
+		w <<= lz;
+		multiply(w, p[0], hi, lo);
+		// the low bits below the 55 we keep might carry, add the next word
+		if ((hi & 0x1FF) == 0x1FF) {
+			uint64_t h, l;
+			multiply(w, p[1], h, l);
+			lo += h;
+			if (h > lo)
+				++hi;
+		}
+		if (lo == 0xFFFFFFFFFFFFFFFFull && (q < -27 || q > 55))
+			return false;
+
+		int upper = static_cast<int>(hi >> 63);
+		int shift = upper + 64 - 52 - 3;
+		uint64_t m = hi >> shift;
+		// floor(log2(10^q)) + 63 + biased exponent adjustments
+		int e2 = (((152170 + 65536)*q) >> 16) + 63 + upper - lz + 1023;
+
+		if (e2 <= 0)
+			return false;
+		// exactly half way, round to even
+		if (lo <= 1 && q >= -4 && q <= 23 && (m & 3) == 1 && (m << shift) == hi)
+			m &= ~1ull;
+		m += m & 1;
+		m >>= 1;
+		if (m >= (2ull << 52)) {
+			m = 1ull << 52;
+			++e2;
+		}
+		m &= ~(1ull << 52);
+		if (e2 >= 0x7FF) {
+			d = HUGE_VAL;
+			return true;
+		}
+
+		uint64_t bits = m | (static_cast<uint64_t>(e2) << 52);
+		memcpy(&d, &bits, 8);
+
+		return true;
+	}
+
+	// -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)? in [s, s + n) into e,
+	// false if it is not a JSON number
+	// integers that fit are JSON_INT64 and kept exactly, the rest JSON_NUMBER
+	inline bool read_number(const char* s, size_t n, json::element& e)
+	{
+		const char* p = s;
+		const char* end = s + n;
+		bool minus = p != end && *p == '-';
+		uint64_t m = 0; // first 19 significant digits
+		int digits = 0, exp10 = 0;
+		bool integer = true, truncated = false;
+
+		if (minus)
+			++p;
+		if (p == end || !isdigit(static_cast<unsigned char>(*p)))
+			return false;
+		if (*p == '0') {
+			++p;
+		}
+		else {
+			for (; p != end && isdigit(static_cast<unsigned char>(*p)); ++p) {
+				if (digits < 19) {
+					m = 10*m + (*p - '0');
+					++digits;
+				}
+				else {
+					++exp10;
+					truncated = true;
+				}
+			}
+		}
+		if (p != end && *p == '.') {
+			integer = false;
+			const char* f = ++p;
+			for (; p != end && isdigit(static_cast<unsigned char>(*p)); ++p) {
+				if (m == 0 && *p == '0') {
+					--exp10; // leading zeros are not significant
+				}
+				else if (digits < 19) {
+					m = 10*m + (*p - '0');
+					++digits;
+					--exp10;
+				}
+				else {
+					truncated = true;
+				}
+			}
+			if (p == f)
+				return false;
+		}
+		if (p != end && (*p == 'e' || *p == 'E')) {
+			integer = false;
+			bool neg = ++p != end && *p == '-';
+			if (p != end && (*p == '-' || *p == '+'))
+				++p;
+			const char* x = p;
+			int x10 = 0;
+			for (; p != end && isdigit(static_cast<unsigned char>(*p)); ++p) {
+				if (x10 < 100000)
+					x10 = 10*x10 + (*p - '0');
+			}
+			if (p == x)
+				return false;
+			exp10 += neg ? -x10 : x10;
+		}
+		if (p != end)
+			return false;
+
+		// -0 is only a double
+#ifndef JSON_ONLY
+		if (integer && exp10 == 0 && !(minus && m == 0) && m <= (minus ? 0x8000000000000000ull : 0x7FFFFFFFFFFFFFFFull)) {
+			e.type = JSON_INT64;
+			e.data.int64 = minus ? static_cast<int64_t>(0 - m) : static_cast<int64_t>(m);
+
+			return true;
+		}
+#endif
+		e.type = JSON_NUMBER;
+		// exact when the digits and the power of ten are both exact doubles
+		if (digits == 0) {
+			e.data.number = minus ? -0.0 : 0.0;
+		}
+		else if (m <= (1ull << 53) && exp10 >= -22 && exp10 <= 22) {
+			static const double pow10[] = {
+				1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+				1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+			};
+			double d = static_cast<double>(m);
+			d = exp10 < 0 ? d/pow10[-exp10] : d*pow10[exp10];
+			e.data.number = minus ? -d : d;
+		}
+		else if (!truncated && eisel_lemire(m, exp10, e.data.number)) {
+			if (minus)
+				e.data.number = -e.data.number;
+		}
+		else {
+			// more than 19 digits or undecided, strtod rounds correctly
+			// given the locale's decimal point
+			char buf[64];
+			std::string big;
+			char* b = buf;
+			if (n >= sizeof(buf)) {
+				big.assign(n + 1, 0);
+				b = &big[0];
+			}
+			memcpy(b, s, n);
+			b[n] = 0;
+			char point = *localeconv()->decimal_point;
+			if (point != '.') {
+				char* q = static_cast<char*>(memchr(b, '.', n));
+				if (q)
+					*q = point;
+			}
+			e.data.number = strtod(b, 0);
+		}
+
+		return true;
+	}
+
+	// shortest digits that read back as the same double, Grisu2 by Florian
+	// Loitsch as laid out in RapidJSON's dtoa, all but a few doubles get the
+	// shortest representation
+	namespace grisu {
+		struct diy_fp {
+			uint64_t f;
+			int e;
+
+			diy_fp(uint64_t f = 0, int e = 0)
+				: f(f), e(e)
+			{ }
+			explicit diy_fp(double d)
+			{
+				uint64_t u;
+				memcpy(&u, &d, 8);
+				int biased = static_cast<int>((u >> 52) & 0x7FF);
+				uint64_t significand = u & 0x000FFFFFFFFFFFFFull;
+				if (biased) {
+					f = significand + 0x0010000000000000ull;
+					e = biased - 0x3FF - 52;
+				}
+				else {
+					f = significand;
+					e = 1 - 0x3FF - 52;
+				}
+			}
+
+			diy_fp operator-(const diy_fp& d) const
+			{
+				return diy_fp(f - d.f, e);
+			}
+			// rounded high 64 bits of the product
+			diy_fp operator*(const diy_fp& d) const
+			{
+				const uint64_t m32 = 0xFFFFFFFFull;
+				uint64_t a = f >> 32, b = f & m32, c = d.f >> 32, dd = d.f & m32;
+				uint64_t ac = a*c, bc = b*c, ad = a*dd, bd = b*dd;
+				uint64_t t = (bd >> 32) + (ad & m32) + (bc & m32) + (1ull << 31);
+
+				return diy_fp(ac + (ad >> 32) + (bc >> 32) + (t >> 32), e + d.e + 64);
+			}
+			diy_fp normalize() const
+			{
+				diy_fp r = *this;
+
+				while (!(r.f & 0x8000000000000000ull)) {
+					r.f <<= 1;
+					--r.e;
+				}
+
+				return r;
+			}
+			// the neighbours half way to the next and previous doubles
+			void boundaries(diy_fp& minus, diy_fp& plus) const
+			{
+				diy_fp p(2*f + 1, e - 1);
+				while (!(p.f & (0x0010000000000000ull << 1))) {
+					p.f <<= 1;
+					--p.e;
+				}
+				p.f <<= 64 - 52 - 2;
+				p.e -= 64 - 52 - 2;
+				diy_fp m = f == 0x0010000000000000ull ? diy_fp(4*f - 1, e - 2) : diy_fp(2*f - 1, e - 1);
+				m.f <<= m.e - p.e;
+				m.e = p.e;
+				minus = m;
+				plus = p;
+			}
+		};
+
+		// 10^k for k = -348, -340, ..., 340 with 64 bit significands
+		inline diy_fp cached_power(int e, int& k)
+		{
+			static const uint64_t f[] = {
+				0xfa8fd5a0081c0288ull, 0xbaaee17fa23ebf76ull, 0x8b16fb203055ac76ull, 0xcf42894a5dce35eaull,
+				0x9a6bb0aa55653b2dull, 0xe61acf033d1a45dfull, 0xab70fe17c79ac6caull, 0xff77b1fcbebcdc4full,
+				0xbe5691ef416bd60cull, 0x8dd01fad907ffc3cull, 0xd3515c2831559a83ull, 0x9d71ac8fada6c9b5ull,
+				0xea9c227723ee8bcbull, 0xaecc49914078536dull, 0x823c12795db6ce57ull, 0xc21094364dfb5637ull,
+				0x9096ea6f3848984full, 0xd77485cb25823ac7ull, 0xa086cfcd97bf97f4ull, 0xef340a98172aace5ull,
+				0xb23867fb2a35b28eull, 0x84c8d4dfd2c63f3bull, 0xc5dd44271ad3cdbaull, 0x936b9fcebb25c996ull,
+				0xdbac6c247d62a584ull, 0xa3ab66580d5fdaf6ull, 0xf3e2f893dec3f126ull, 0xb5b5ada8aaff80b8ull,
+				0x87625f056c7c4a8bull, 0xc9bcff6034c13053ull, 0x964e858c91ba2655ull, 0xdff9772470297ebdull,
+				0xa6dfbd9fb8e5b88full, 0xf8a95fcf88747d94ull, 0xb94470938fa89bcfull, 0x8a08f0f8bf0f156bull,
+				0xcdb02555653131b6ull, 0x993fe2c6d07b7facull, 0xe45c10c42a2b3b06ull, 0xaa242499697392d3ull,
+				0xfd87b5f28300ca0eull, 0xbce5086492111aebull, 0x8cbccc096f5088ccull, 0xd1b71758e219652cull,
+				0x9c40000000000000ull, 0xe8d4a51000000000ull, 0xad78ebc5ac620000ull, 0x813f3978f8940984ull,
+				0xc097ce7bc90715b3ull, 0x8f7e32ce7bea5c70ull, 0xd5d238a4abe98068ull, 0x9f4f2726179a2245ull,
+				0xed63a231d4c4fb27ull, 0xb0de65388cc8ada8ull, 0x83c7088e1aab65dbull, 0xc45d1df942711d9aull,
+				0x924d692ca61be758ull, 0xda01ee641a708deaull, 0xa26da3999aef774aull, 0xf209787bb47d6b85ull,
+				0xb454e4a179dd1877ull, 0x865b86925b9bc5c2ull, 0xc83553c5c8965d3dull, 0x952ab45cfa97a0b3ull,
+				0xde469fbd99a05fe3ull, 0xa59bc234db398c25ull, 0xf6c69a72a3989f5cull, 0xb7dcbf5354e9beceull,
+				0x88fcf317f22241e2ull, 0xcc20ce9bd35c78a5ull, 0x98165af37b2153dfull, 0xe2a0b5dc971f303aull,
+				0xa8d9d1535ce3b396ull, 0xfb9b7cd9a4a7443cull, 0xbb764c4ca7a44410ull, 0x8bab8eefb6409c1aull,
+				0xd01fef10a657842cull, 0x9b10a4e5e9913129ull, 0xe7109bfba19c0c9dull, 0xac2820d9623bf429ull,
+				0x80444b5e7aa7cf85ull, 0xbf21e44003acdd2dull, 0x8e679c2f5e44ff8full, 0xd433179d9c8cb841ull,
+				0x9e19db92b4e31ba9ull, 0xeb96bf6ebadf77d9ull, 0xaf87023b9bf0ee6bull
+			};
+			static const int16_t x[] = {
+				-1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954,
+				-927, -901, -874, -847, -821, -794, -768, -741, -715, -688, -661,
+				-635, -608, -582, -555, -529, -502, -475, -449, -422, -396, -369,
+				-343, -316, -289, -263, -236, -210, -183, -157, -130, -103, -77,
+				-50, -24, 3, 30, 56, 83, 109, 136, 162, 189, 216,
+				242, 269, 295, 322, 348, 375, 402, 428, 455, 481, 508,
+				534, 561, 588, 614, 641, 667, 694, 720, 747, 774, 800,
+				827, 853, 880, 907, 933, 960, 986, 1013, 1039, 1066
+			};
+			double dk = (-61 - e)*0.30102999566398114 + 347;
+			int i = static_cast<int>(dk);
+			if (dk - i > 0.0)
+				++i;
+			i = (i >> 3) + 1;
+			k = -(-348 + i*8);
+
+			return diy_fp(f[i], x[i]);
+		}
+
+		inline void round(char* buf, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+		{
+			while (rest < wp_w && delta - rest >= ten_kappa
+				&& (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+				--buf[len - 1];
+				rest += ten_kappa;
+			}
+		}
+
+		inline int decimal_digits(uint32_t n)
+		{
+			int d = 1;
+
+			while (n >= 10 && d < 10) {
+				n /= 10;
+				++d;
+			}
+
+			return d;
+		}
+
+		inline void digits(const diy_fp& w, const diy_fp& mp, uint64_t delta, char* buf, int& len, int& k)
+		{
+			static const uint64_t pow10[] = {
+				1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+				100000000ull, 1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull,
+				10000000000000ull, 100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+				100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull
+			};
+			const diy_fp one(1ull << -mp.e, mp.e);
+			const diy_fp wp_w = mp - w;
+			uint32_t p1 = static_cast<uint32_t>(mp.f >> -one.e);
+			uint64_t p2 = mp.f & (one.f - 1);
+			int kappa = decimal_digits(p1);
+
+			len = 0;
+			while (kappa > 0) {
+				uint32_t d = p1/static_cast<uint32_t>(pow10[kappa - 1]);
+				p1 %= static_cast<uint32_t>(pow10[kappa - 1]);
+				if (d || len)
+					buf[len++] = static_cast<char>('0' + d);
+				--kappa;
+				uint64_t t = (static_cast<uint64_t>(p1) << -one.e) + p2;
+				if (t <= delta) {
+					k += kappa;
+					round(buf, len, delta, t, pow10[kappa] << -one.e, wp_w.f);
+					return;
+				}
+			}
+			for (;;) {
+				p2 *= 10;
+				delta *= 10;
+				char d = static_cast<char>(p2 >> -one.e);
+				if (d || len)
+					buf[len++] = static_cast<char>('0' + d);
+				p2 &= one.f - 1;
+				--kappa;
+				if (p2 < delta) {
+					k += kappa;
+					int i = -kappa;
+					round(buf, len, delta, p2, one.f, wp_w.f*(i < 20 ? pow10[i] : 0));
+					return;
+				}
+			}
+		}
+
+		// digits of d > 0 into buf, d = buf*10^k
+		inline int shortest(double d, char* buf, int& k)
+		{
+			diy_fp v(d), minus, plus;
+			int len;
+
+			v.boundaries(minus, plus);
+			diy_fp c = cached_power(plus.e, k);
+			diy_fp w = v.normalize()*c, wp = plus*c, wm = minus*c;
+			++wm.f;
+			--wp.f;
+			digits(w, wp, wp.f - wm.f, buf, len, k);
+
+			return len;
+		}
+
+		inline int exponent(int k, char* buf)
+		{
+			char* p = buf;
+
+			if (k < 0) {
+				*p++ = '-';
+				k = -k;
+			}
+			if (k >= 100) {
+				*p++ = static_cast<char>('0' + k/100);
+				k %= 100;
+				*p++ = static_cast<char>('0' + k/10);
+			}
+			else if (k >= 10) {
+				*p++ = static_cast<char>('0' + k/10);
+			}
+			*p++ = static_cast<char>('0' + k%10);
+
+			return static_cast<int>(p - buf);
+		}
+
+		// digits buf[0, len) times 10^k laid out like JavaScript, keeping a
+		// fraction on whole numbers so they read back as doubles
+		inline int format(char* buf, int len, int k)
+		{
+			int kk = len + k; // 10^(kk - 1) <= v < 10^kk
+
+			if (k >= 0 && kk <= 21) {
+				// 1234e7 -> 12340000000.0
+				for (int i = len; i < kk; ++i)
+					buf[i] = '0';
+				buf[kk] = '.';
+				buf[kk + 1] = '0';
+
+				return kk + 2;
+			}
+			if (kk > 0 && kk <= 21) {
+				// 1234e-2 -> 12.34
+				memmove(buf + kk + 1, buf + kk, len - kk);
+				buf[kk] = '.';
+
+				return len + 1;
+			}
+			if (kk > -6 && kk <= 0) {
+				// 1234e-6 -> 0.001234
+				int offset = 2 - kk;
+				memmove(buf + offset, buf, len);
+				buf[0] = '0';
+				buf[1] = '.';
+				for (int i = 2; i < offset; ++i)
+					buf[i] = '0';
+
+				return len + offset;
+			}
+			if (len == 1) {
+				// 1e30
+				buf[1] = 'e';
+
+				return 2 + exponent(kk - 1, buf + 2);
+			}
+			// 1234e30 -> 1.234e33
+			memmove(buf + 2, buf + 1, len - 1);
+			buf[1] = '.';
+			buf[len + 1] = 'e';
+
+			return len + 2 + exponent(kk - 1, buf + len + 2);
+		}
+	} // namespace grisu
+
+	// shortest text of d that reads back as d into buf, which has room for
+	// 32 characters, returns its length
+	// JSON has no infinity or NaN, they are written as null
+	inline size_t write_number(double d, char* buf)
+	{
+		if (d != d || d - d != 0) {
+			memcpy(buf, "null", 4);
+
+			return 4;
+		}
+
+		char* p = buf;
+		if (std::signbit(d)) {
+			*p++ = '-';
+			d = -d;
+		}
+		if (d == 0) {
+			memcpy(p, "0.0", 3);
+
+			return p + 3 - buf;
+		}
+
+		int k;
+		int len = grisu::shortest(d, p, k);
+
+		return p + grisu::format(p, len, k) - buf;
+	}
+	// integers are written exactly
+	inline size_t write_number(int64_t i, char* buf)
+	{
+		char t[20];
+		char* q = t + sizeof(t);
+		uint64_t u = i < 0 ? 0 - static_cast<uint64_t>(i) : static_cast<uint64_t>(i);
+
+		do {
+			*--q = static_cast<char>('0' + u%10);
+			u /= 10;
+		} while (u);
+
+		char* p = buf;
+		if (i < 0)
+			*p++ = '-';
+		memcpy(p, q, t + sizeof(t) - q);
+
+		return p + (t + sizeof(t) - q) - buf;
+	}
+
+	// strings need not be null terminated
+	inline bool operator==(const string& s, const string& t)
+	{
+		return s.size == t.size && (s.size == 0 || 0 == memcmp(s.data, t.data, s.size));
+	}
+	inline bool operator==(const string& s, const char* t)
+	{
+		return s == string_(strlen(t), t);
+	}
+	inline bool operator<(const string& s, const string& t)
+	{
+		size_t n = s.size < t.size ? s.size : t.size;
+		int c = n ? memcmp(s.data, t.data, n) : 0;
+
+		return c < 0 || (c == 0 && s.size < t.size);
+	}
+	inline bool operator<(const string& s, const char* t)
+	{
+		return s < string_(strlen(t), t);
+	}
+
+	inline bool operator==(const array& a, const array& b)
+	{
+		return a.size == b.size && std::equal(a.element, a.element + a.size, b.element);
+	}
+	inline bool operator<(const array& a, const array& b)
+	{
+		return std::lexicographical_compare(a.element, a.element + a.size, b.element, b.element + b.size);
+	}
+
+	inline bool operator==(const byte& a, const byte& b)
+	{
+		return a.size == b.size && 0 == memcmp(a.data, b.data, a.size);
+	}
+	inline bool operator<(const byte& a, const byte& b)
+	{
+		return std::lexicographical_compare(a.data, a.data + a.size, b.data, b.data + b.size);
+	}
+
+	// contents of a string element, unescaped into tmp if need be
+	inline string text(const element& e, std::string& tmp)
+	{
+		if (!(e.flags & JSON_ESCAPED))
+			return e.str();
+
+		tmp = unescape(e.data.string);
+
+		return string_(tmp.size(), tmp.data());
+	}
+	inline bool operator==(const element& e, const string& s)
+	{
+		std::string tmp;
+
+		return e.type == JSON_STRING && text(e, tmp) == s;
 	}
 	inline bool operator<(const element& e, const string& s)
 	{
-		return e.type == JSON_STRING && e.data.string < s;
+		std::string tmp;
+
+		return e.type == JSON_STRING && text(e, tmp) < s;
 	}
 	inline bool operator==(const element& e, const char* s)
 	{
-		return e.type == JSON_STRING && e.data.string == s;
+		return e == string_(strlen(s), s);
 	}
 	inline bool operator<(const element& e, const char* s)
 	{
-		return e.type == JSON_STRING && e.data.string < s;
+		return e < string_(strlen(s), s);
 	}
 
+	// integers compare by value too
 	inline bool operator==(const element& e, double number)
 	{
-		return e.type == JSON_NUMBER && e.data.number == number;
+		return e.type == JSON_NUMBER ? e.data.number == number
+#ifndef JSON_ONLY
+			: e.type == JSON_INT64 ? static_cast<double>(e.data.int64) == number
+			: e.type == JSON_INT32 ? e.data.int32 == number
+#endif
+			: false;
 	}
 	inline bool operator<(const element& e, double number)
 	{
-		return e.type == JSON_NUMBER && e.data.number < number;
+		return e.type == JSON_NUMBER ? e.data.number < number
+#ifndef JSON_ONLY
+			: e.type == JSON_INT64 ? static_cast<double>(e.data.int64) < number
+			: e.type == JSON_INT32 ? e.data.int32 < number
+#endif
+			: false;
 	}
 
 	inline bool operator==(const element& e, const array& array)
@@ -198,10 +2028,12 @@ namespace json {
 #endif
 	inline bool operator==(const element& a, const element& b)
 	{
+		std::string tmp;
+
 		return a.type != b.type ? false
-			: a.type == JSON_STRING ? a == b.data.string
+			: a.type == JSON_STRING ? a == text(b, tmp)
 			: a.type == JSON_NUMBER ? a == b.data.number
-			: a.type == JSON_OBJECT ? a.data.object == b.data.object
+			: a.type == JSON_OBJECT ? json::object_equal(a.data.object, b.data.object)
 			: a.type == JSON_ARRAY ? a == b.data.array
 			: a.type == JSON_TRUE ? b.type == JSON_TRUE
 			: a.type == JSON_FALSE ? b.type == JSON_FALSE
@@ -217,11 +2049,13 @@ namespace json {
 	}
 	inline bool operator<(const element& a, const element& b)
 	{
+		std::string tmp;
+
 		return a.type < b.type ? true
 			: a.type >  b.type ? false
-			: a.type == JSON_STRING ? a < b.data.string
+			: a.type == JSON_STRING ? a < text(b, tmp)
 			: a.type == JSON_NUMBER ? a < b.data.number
-			: a.type == JSON_OBJECT ? a.data.object < b.data.object
+			: a.type == JSON_OBJECT ? json::object_less(a.data.object, b.data.object)
 			: a.type == JSON_ARRAY ? a < b.data.array
 			: a.type == JSON_TRUE ? false
 			: a.type == JSON_FALSE ? b.type == JSON_TRUE
@@ -238,6 +2072,7 @@ namespace json {
 
 	// real class for managing memory
 	class value : public element {
+		friend class parse::builder;
 	public:
 		operator json::element&()
 		{
@@ -258,14 +2093,39 @@ namespace json {
 		}
 		value(const value& v)
 		{
+			type = JSON_UNDEFINED;
 			operator=(v);
 		}
+		// takes the payload, v is left undefined
+		value(value&& v) noexcept
+		{
+			static_cast<json::element&>(*this) = v;
+			v.type = JSON_UNDEFINED;
+		}
+		// v may be part of this value, it is detached before this is deleted
+		value& operator=(value&& v) noexcept
+		{
+			if (this != &v) {
+				json::element e = v;
+
+				v.type = JSON_UNDEFINED;
+				delete_value();
+				static_cast<json::element&>(*this) = e;
+			}
+
+			return *this;
+		}
 		value& operator=(const value& v)
 		{
 			if (this != &v) {
 				switch (v.type) {
-				case JSON_STRING:
-					operator=(v.data.string);
+				case JSON_STRING: {
+					std::string tmp;
+					operator=(text(v, tmp));
+					break;
+				}
+				case JSON_OBJECT:
+					operator=(*v.data.object);
 					break;
 				case JSON_ARRAY:
 					operator=(v.data.array);
@@ -276,6 +2136,7 @@ namespace json {
 					break;
 #endif
 				default: // non pointer types
+					delete_value();
 					type = v.type;
 					data = v.data;
 				}
@@ -285,20 +2146,58 @@ namespace json {
 		}
 		value(const json::element& e)
 		{
+			type = JSON_UNDEFINED;
 			operator=(e);
 		}
-		value& operator=(const json::element& e)
+		// deep copy into an arena
+		value(const json::element& e, json::arena& a)
+		{
+			type = JSON_UNDEFINED;
+			assign(e, a);
+		}
+		value& assign(const json::element& e, json::arena& a)
 		{
+			return assign_(e, a);
+		}
+		// deep copy owned by m
+		value(const json::element& e, json::memory& m)
+		{
+			type = JSON_UNDEFINED;
+			assign(e, m);
+		}
+		value& assign(const json::element& e, json::memory& m)
+		{
+			return assign_(e, m);
+		}
+	private:
+		// M is json::arena or json::memory
+		template<class M>
+		value& assign_(const json::element& e, M& a)
+		{
+			if (this == &e)
+				return *this;
+
+			delete_value();
 			switch (e.type) {
-			case JSON_STRING:
-				operator=(e.data.string);
+			case JSON_STRING: {
+				std::string tmp;
+				json::string t = text(e, tmp);
+				construct_string(t.data, t.size, a);
+				break;
+			}
+			case JSON_OBJECT:
+				construct_object(a);
+				for (json::object::const_iterator i = e.data.object->begin(); i != e.data.object->end(); ++i)
+					(*data.object)[i->first].assign(i->second, a);
 				break;
 			case JSON_ARRAY:
-				operator=(e.data.array);
+				construct_array(e.data.array.size, a);
+				for (size_t i = 0; i < e.data.array.size; ++i)
+					operator[](i).assign(e.data.array.element[i], a);
 				break;
 #ifndef JSON_ONLY
 			case JSON_BYTE:
-				operator=(e.data.byte);
+				construct_byte(e.data.byte.size, e.data.byte.data, a);
 				break;
 #endif
 			default: // non pointer types
@@ -308,10 +2207,43 @@ namespace json {
 
 			return *this;
 		}
-		~value()
-		{
+	public:
+		value& operator=(const json::element& e)
+		{
+			switch (e.type) {
+			case JSON_STRING: {
+				std::string tmp;
+				operator=(text(e, tmp));
+				break;
+			}
+			case JSON_OBJECT:
+				operator=(*e.data.object);
+				break;
+			case JSON_ARRAY:
+				operator=(e.data.array);
+				break;
+#ifndef JSON_ONLY
+			case JSON_BYTE:
+				operator=(e.data.byte);
+				break;
+#endif
+			default: // non pointer types
+				delete_value();
+				type = e.type;
+				data = e.data;
+			}
+
+			return *this;
+		}
+		~value()
+		{
 			delete_value();
 		}
+		// exchange payloads without copying
+		void swap(value& v)
+		{
+			std::swap(static_cast<json::element&>(*this), static_cast<json::element&>(v));
+		}
 
 		bool operator==(const value& v) const
 		{
@@ -327,6 +2259,22 @@ namespace json {
 		{
 			construct_string(s.data, s.size);
 		}
+		value(const char* s, json::arena& a)
+		{
+			construct_string(s, strlen(s), a);
+		}
+		value(const json::string& s, json::arena& a)
+		{
+			construct_string(s.data, s.size, a);
+		}
+		value(const char* s, json::memory& m)
+		{
+			construct_string(s, strlen(s), m);
+		}
+		value(const json::string& s, json::memory& m)
+		{
+			construct_string(s.data, s.size, m);
+		}
 		value& operator=(const char* s)
 		{
 			delete_value();
@@ -341,6 +2289,37 @@ namespace json {
 
 			return *this;
 		}
+		// replace a string left escaped by a view parse with its decoded contents
+		value& unescape()
+		{
+			if (type == JSON_STRING && (flags & JSON_ESCAPED)) {
+				std::string tmp = json::unescape(data.string);
+				delete_value();
+				construct_string(tmp.data(), tmp.size());
+			}
+
+			return *this;
+		}
+		value& unescape(json::arena& a)
+		{
+			if (type == JSON_STRING && (flags & JSON_ESCAPED)) {
+				std::string tmp = json::unescape(data.string);
+				delete_value();
+				construct_string(tmp.data(), tmp.size(), a);
+			}
+
+			return *this;
+		}
+		value& unescape(json::memory& m)
+		{
+			if (type == JSON_STRING && (flags & JSON_ESCAPED)) {
+				std::string tmp = json::unescape(data.string);
+				delete_value();
+				construct_string(tmp.data(), tmp.size(), m);
+			}
+
+			return *this;
+		}
 		// specialize for const char*
 		bool operator==(const char* s) const
 		{
@@ -351,6 +2330,42 @@ namespace json {
 			return operator const json::element&() < s;
 		}
 
+		// object
+		explicit value(const json::object& o)
+		{
+			construct_object(o);
+		}
+		value& operator=(const json::object& o)
+		{
+			if (type != JSON_OBJECT || data.object != &o) {
+				delete_value();
+				construct_object(o);
+			}
+
+			return *this;
+		}
+		// deep copy of o owned by m
+		value(const json::object& o, json::memory& m)
+		{
+			construct_object(m);
+			for (json::object::const_iterator i = o.begin(); i != o.end(); ++i)
+				(*data.object)[i->first].assign(i->second, m);
+		}
+		// takes the members of o
+		explicit value(json::object&& o)
+		{
+			construct_object(std::move(o));
+		}
+		value& operator=(json::object&& o)
+		{
+			if (type != JSON_OBJECT || data.object != &o) {
+				value v(std::move(o));
+				swap(v);
+			}
+
+			return *this;
+		}
+
 		// number
 		explicit value(double number)
 		{
@@ -379,6 +2394,14 @@ namespace json {
 		{
 			construct_array(n);
 		}
+		value(int n, json::arena& a)
+		{
+			construct_array(n, a);
+		}
+		value(int n, json::memory& m)
+		{
+			construct_array(n, m);
+		}
 		value& operator=(const array& a)
 		{
 			delete_value();
@@ -398,6 +2421,23 @@ namespace json {
 			// ensure type == JSON_ARRAY;
 			return static_cast<const json::value&>(data.array.element[i]);
 		}
+		// elements that fit without reallocating
+		size_t capacity() const
+		{
+			return type != JSON_ARRAY ? 0
+				: flags & JSON_BORROWED ? data.array.size
+				: header(data.array.element)->capacity;
+		}
+		json::value& reserve(size_t n)
+		{
+			if (type == JSON_UNDEFINED)
+				construct_array(0);
+			ensure (type == JSON_ARRAY && !(flags & JSON_BORROWED));
+			if (n > capacity())
+				grow_array(n);
+
+			return *this;
+		}
 		json::value& push_back(const json::element& element)
 		{
 			push_back_array(element);
@@ -410,12 +2450,40 @@ namespace json {
 			
 			return *this;
 		}
+		json::value& push_back(json::value&& v)
+		{
+			json::element* e = append_slot();
+
+			*e = v;
+			v.type = JSON_UNDEFINED;
+			++data.array.size;
+
+			return *this;
+		}
+		// the new last element, constructed in place from a
+		template<class... A>
+		json::value& emplace_back(A&&... a)
+		{
+			json::value* e = new (append_slot()) json::value(std::forward<A>(a)...);
+
+			++data.array.size;
+
+			return *e;
+		}
 #ifndef JSON_ONLY
 		// byte
 		value(size_t size, uint8_t* data)
 		{
 			construct_byte(size, data);
 		}
+		value(size_t size, const uint8_t* data, json::arena& a)
+		{
+			construct_byte(size, data, a);
+		}
+		value(size_t size, const uint8_t* data, json::memory& m)
+		{
+			construct_byte(size, data, m);
+		}
 		value& operator=(const byte& b)
 		{
 			delete_value();
@@ -471,72 +2539,278 @@ namespace json {
 		}
 #endif
 	protected:
-		void construct_string(const char* s, size_t size = 0)
+		void construct_string(const char* s)
+		{
+			construct_string(s, strlen(s));
+		}
+		// s need not be null terminated, short strings are not allocated
+		void construct_string(const char* s, size_t size)
+		{
+			if (construct_inline(s, size))
+				return;
+			type = JSON_STRING;
+			flags = JSON_OWNED;
+			data.string.size = size;
+			char* p = static_cast<char*>(json::allocate(size + 1));
+			memcpy(p, s, size);
+			p[size] = 0;
+			data.string.data = p;
+		}
+		void construct_string(const char* s, size_t size, json::arena& a)
+		{
+			if (construct_inline(s, size)) {
+				flags |= JSON_BORROWED; // like the rest of the arena
+				return;
+			}
+			type = JSON_STRING;
+			flags = JSON_BORROWED;
+			data.string.size = size;
+			char* p = static_cast<char*>(a.allocate(size + 1, 1));
+			memcpy(p, s, size);
+			p[size] = 0;
+			data.string.data = p;
+		}
+		void construct_string(const char* s, size_t size, json::memory& m)
+		{
+			if (&m == &json::heap())
+				return construct_string(s, size);
+			if (construct_inline(s, size))
+				return;
+			type = JSON_STRING;
+			flags = JSON_MEMORY;
+			data.string.size = size;
+			char* p = static_cast<char*>(allocate_payload(size + 1, m));
+			memcpy(p, s, size);
+			p[size] = 0;
+			data.string.data = p;
+		}
+		bool construct_inline(const char* s, size_t size)
 		{
+			const size_t n = sizeof(data.chars) - 1;
+
+			if (size > n)
+				return false;
 			type = JSON_STRING;
-			data.string.size = size ? size : strlen(s);
-			data.string.data = new char[data.string.size + 1];
-			strcpy(const_cast<char*>(data.string.data), s);
+			flags = JSON_INLINE;
+			memcpy(data.chars, s, size);
+			memset(data.chars + size, 0, n - size);
+			data.chars[n] = static_cast<char>(n - size);
+
+			return true;
 		}
 		void delete_string(void)
 		{
-			delete [] data.string.data;
+			if (!(flags & (JSON_BORROWED | JSON_INLINE)))
+				deallocate_payload(const_cast<char*>(data.string.data), data.string.size + 1, flags);
+			type = JSON_UNDEFINED;
+		}
+
+		void construct_object(const json::object& o)
+		{
+			type = JSON_OBJECT;
+			flags = JSON_OWNED;
+			data.object = new json::object(o);
+			json::allocated(sizeof(json::object));
+		}
+		void construct_object(json::object&& o)
+		{
+			type = JSON_OBJECT;
+			flags = JSON_OWNED;
+			data.object = new json::object(std::move(o));
+			json::allocated(sizeof(json::object));
+		}
+		void construct_object(json::arena& a)
+		{
+			type = JSON_OBJECT;
+			flags = JSON_BORROWED;
+			data.object = a.create<json::object>(json::object::allocator_type(&a));
+		}
+		void construct_object(json::memory& m)
+		{
+			if (&m == &json::heap())
+				return construct_object(json::object());
+			type = JSON_OBJECT;
+			flags = JSON_MEMORY;
+			data.object = new (allocate_payload(sizeof(json::object), m)) json::object(json::object::allocator_type(&m));
+		}
+		void delete_object(void)
+		{
+			if (flags & JSON_MEMORY) {
+				data.object->~object();
+				deallocate_payload(data.object, sizeof(json::object), flags);
+			}
+			else if (!(flags & JSON_BORROWED)) {
+				delete data.object;
+				json::deallocated(sizeof(json::object));
+			}
 			type = JSON_UNDEFINED;
 		}
 
+		// payloads from a memory other than the heap carry it in front
+		struct memory_header {
+			union {
+				json::memory* m;
+				double align_;
+			};
+		};
+		static void* allocate_payload(size_t n, json::memory& m)
+		{
+			memory_header* h = static_cast<memory_header*>(m.allocate(sizeof(memory_header) + n, sizeof(memory_header)));
+
+			h->m = &m;
+
+			return h + 1;
+		}
+		// p from allocate_payload if f has JSON_MEMORY, otherwise json::allocate
+		static void deallocate_payload(void* p, size_t n, unsigned char f)
+		{
+			if (f & JSON_MEMORY) {
+				memory_header* h = static_cast<memory_header*>(p) - 1;
+				h->m->deallocate(h, sizeof(memory_header) + n, sizeof(memory_header));
+			}
+			else {
+				json::deallocate(p, n);
+			}
+		}
+		json::memory& payload_memory(void* p) const
+		{
+			return flags & JSON_MEMORY ? *(static_cast<memory_header*>(p) - 1)->m : json::heap();
+		}
+
+		// owned arrays keep their capacity in front of the elements
+		struct array_header {
+			union {
+				size_t capacity;
+				double align_;
+			};
+		};
+		static array_header* header(json::element* e)
+		{
+			return reinterpret_cast<array_header*>(e) - 1;
+		}
+		static const array_header* header(const json::element* e)
+		{
+			return reinterpret_cast<const array_header*>(e) - 1;
+		}
+		static size_t array_bytes(size_t n)
+		{
+			return sizeof(array_header) + n*sizeof(json::element);
+		}
+		static json::element* allocate_array(size_t n, json::element* e = 0)
+		{
+			array_header* h = e
+				? static_cast<array_header*>(json::reallocate(header(e), array_bytes(header(e)->capacity), array_bytes(n)))
+				: static_cast<array_header*>(json::allocate(array_bytes(n)));
+			h->capacity = n;
+
+			return reinterpret_cast<json::element*>(h + 1);
+		}
+		static json::element* allocate_array(size_t n, json::memory& m)
+		{
+			array_header* h = static_cast<array_header*>(allocate_payload(array_bytes(n), m));
+			h->capacity = n;
+
+			return reinterpret_cast<json::element*>(h + 1);
+		}
+		// capacity at least n, growing geometrically
+		void grow_array(size_t n)
+		{
+			size_t c = capacity();
+
+			c = c < 4 ? 4 : c + c/2;
+			if (n > c)
+				c = n;
+			if (flags & JSON_MEMORY) {
+				// no realloc in a memory
+				json::element* e = allocate_array(c, payload_memory(header(data.array.element)));
+				memcpy(e, data.array.element, data.array.size*sizeof(json::element));
+				deallocate_payload(header(data.array.element), array_bytes(capacity()), flags);
+				data.array.element = e;
+			}
+			else {
+				data.array.element = allocate_array(c, data.array.element);
+			}
+		}
+
 		void construct_array(size_t n)
 		{
 			type = JSON_ARRAY;
+			flags = JSON_OWNED;
+			data.array.size = n;
+			data.array.element = allocate_array(n);
+			for (size_t i = 0; i < n; ++i)
+				data.array.element[i].type = JSON_UNDEFINED;
+		}
+		void construct_array(size_t n, json::arena& a)
+		{
+			type = JSON_ARRAY;
+			flags = JSON_BORROWED;
+			data.array.size = n;
+			data.array.element = static_cast<json::element*>(a.allocate(n*sizeof(json::element)));
+			for (size_t i = 0; i < n; ++i)
+				data.array.element[i].type = JSON_UNDEFINED;
+		}
+		void construct_array(size_t n, json::memory& m)
+		{
+			if (&m == &json::heap())
+				return construct_array(n);
+			type = JSON_ARRAY;
+			flags = JSON_MEMORY;
 			data.array.size = n;
-			data.array.element = static_cast<json::element*>(malloc(n*sizeof(json::element)));
+			data.array.element = allocate_array(n, m);
 			for (size_t i = 0; i < n; ++i)
 				data.array.element[i].type = JSON_UNDEFINED;
 		}
 		void delete_array(void)
 		{
-			for (size_t i = 0; i < data.array.size; ++i)
-				operator[](i).delete_value();
+			if (!(flags & JSON_BORROWED)) {
+				for (size_t i = 0; i < data.array.size; ++i)
+					operator[](i).delete_value();
 			
-			free(data.array.element);
+				deallocate_payload(header(data.array.element), array_bytes(capacity()), flags);
+			}
 
 			type = JSON_UNDEFINED;
 		}
-		void push_back_array(const json::element& element)
+		// room for an element at data.array.size, which the caller fills
+		// and counts, a value other than an array becomes its first element
+		json::element* append_slot()
 		{
-			if (type == JSON_UNDEFINED) {
-				construct_array(1);
-				operator[](0) = element;
-			}
-			else {
-				if (type != JSON_ARRAY) {
-					value this_(*this);
-					delete_value();
-					construct_array(2);
-					operator[](0) = this_;
-					operator[](1) = element;
-				}
-				else {
-					data.array.element = static_cast<json::element*>(realloc(data.array.element, (data.array.size + 1)*sizeof(json::element)));
-					operator[](data.array.size) = element;
-					++data.array.size;
-				}
+			ensure (type != JSON_ARRAY || !(flags & JSON_BORROWED));
+			if (type != JSON_ARRAY) {
+				json::element e = *this;
+				construct_array(type != JSON_UNDEFINED);
+				if (data.array.size)
+					data.array.element[0] = e;
 			}
+			if (data.array.size == capacity())
+				grow_array(data.array.size + 1);
+
+			return data.array.element + data.array.size;
+		}
+		void push_back_array(const json::element& element)
+		{
+			json::element* e = append_slot();
+
+			e->type = JSON_UNDEFINED;
+			static_cast<json::value&>(*e) = element;
+			++data.array.size;
 		}
 		void push_back_array(const array& array)
 		{
+			ensure (type != JSON_ARRAY || !(flags & JSON_BORROWED));
 			if (type == JSON_UNDEFINED) {
 				operator=(array);
 			}
 			else {
-				if (type != JSON_ARRAY) {
-					value this_(*this);
-					delete_value();
-					construct_array(1);
-					operator[](0) = this_;
-				}
-				data.array.element = static_cast<json::element*>(realloc(data.array.element, (data.array.size + array.size)*sizeof(json::element)));
-				for (size_t i = 0; i < array.size; ++i)
+				if (type != JSON_ARRAY)
+					append_slot();
+				if (data.array.size + array.size > capacity())
+					grow_array(data.array.size + array.size);
+				for (size_t i = 0; i < array.size; ++i) {
+					data.array.element[data.array.size + i].type = JSON_UNDEFINED;
 					operator[](data.array.size + i) = array.element[i];
+				}
 				data.array.size += array.size;
 			}
 		}
@@ -544,13 +2818,33 @@ namespace json {
 		void construct_byte(size_t n, const uint8_t* b)
 		{
 			type = JSON_BYTE;
+			flags = JSON_OWNED;
+			data.byte.size = n;
+			data.byte.data = static_cast<uint8_t*>(json::allocate(n));
+			memcpy(const_cast<uint8_t*>(data.byte.data), b, n);
+		}
+		void construct_byte(size_t n, const uint8_t* b, json::arena& a)
+		{
+			type = JSON_BYTE;
+			flags = JSON_BORROWED;
 			data.byte.size = n;
-			data.byte.data = new uint8_t[n];
+			data.byte.data = static_cast<uint8_t*>(a.allocate(n, 1));
+			memcpy(const_cast<uint8_t*>(data.byte.data), b, n);
+		}
+		void construct_byte(size_t n, const uint8_t* b, json::memory& m)
+		{
+			if (&m == &json::heap())
+				return construct_byte(n, b);
+			type = JSON_BYTE;
+			flags = JSON_MEMORY;
+			data.byte.size = n;
+			data.byte.data = static_cast<uint8_t*>(allocate_payload(n, m));
 			memcpy(const_cast<uint8_t*>(data.byte.data), b, n);
 		}
 		void delete_byte(void)
 		{
-			delete [] data.byte.data;
+			if (!(flags & JSON_BORROWED))
+				deallocate_payload(const_cast<uint8_t*>(data.byte.data), data.byte.size, flags);
 			type = JSON_UNDEFINED;
 		}
 #endif
@@ -560,6 +2854,9 @@ namespace json {
 			case JSON_STRING:
 				delete_string();
 				break;
+			case JSON_OBJECT:
+				delete_object();
+				break;
 			case JSON_ARRAY:
 				delete_array();
 				break;
@@ -574,191 +2871,2563 @@ namespace json {
 		}
 	};
 
-	namespace parse {
-		inline bool eat(char c, std::istream& is)
-		{
-			char c_;
+	inline void swap(value& a, value& b)
+	{
+		a.swap(b);
+	}
 
-			is >> std::skipws >> c_;
+	inline bool object_equal(const object* a, const object* b)
+	{
+		return *a == *b;
+	}
+	inline bool object_less(const object* a, const object* b)
+	{
+		return *a < *b;
+	}
 
-			return c == c_;
-		}
-		inline char eat(const char* s, std::istream& is)
-		{
-			char c_;
+	namespace parse {
+		//
+		// buffer based parser
+		//
 
-			is >> std::skipws >> c_;
+		// classify whitespace and quotes a block at a time
+		namespace scan {
+			inline bool is_space(char c)
+			{
+				return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+			}
+#ifdef JSON_SSE2
+			// index of lowest set bit, mask != 0
+			inline unsigned first(unsigned mask)
+			{
+#ifdef _MSC_VER
+				unsigned long i;
+				_BitScanForward(&i, mask);
 
-			return *strchr(s, c_);
-		}
+				return i;
+#else
+				return __builtin_ctz(mask);
+#endif
+			}
+#endif
+			// first non whitespace character in [s, e)
+			inline const char* skip_space(const char* s, const char* e)
+			{
+#ifdef JSON_AVX2
+				const __m256i sp = _mm256_set1_epi8(' '), nl = _mm256_set1_epi8('\n');
+				const __m256i cr = _mm256_set1_epi8('\r'), tb = _mm256_set1_epi8('\t');
+				for (; e - s >= 32; s += 32) {
+					__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+					__m256i ws = _mm256_or_si256(
+						_mm256_or_si256(_mm256_cmpeq_epi8(x, sp), _mm256_cmpeq_epi8(x, nl)),
+						_mm256_or_si256(_mm256_cmpeq_epi8(x, cr), _mm256_cmpeq_epi8(x, tb)));
+					unsigned m = ~static_cast<unsigned>(_mm256_movemask_epi8(ws));
+					if (m)
+						return s + first(m);
+				}
+#endif
+#ifdef JSON_SSE2
+				const __m128i sp_ = _mm_set1_epi8(' '), nl_ = _mm_set1_epi8('\n');
+				const __m128i cr_ = _mm_set1_epi8('\r'), tb_ = _mm_set1_epi8('\t');
+				for (; e - s >= 16; s += 16) {
+					__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+					__m128i ws = _mm_or_si128(
+						_mm_or_si128(_mm_cmpeq_epi8(x, sp_), _mm_cmpeq_epi8(x, nl_)),
+						_mm_or_si128(_mm_cmpeq_epi8(x, cr_), _mm_cmpeq_epi8(x, tb_)));
+					unsigned m = ~static_cast<unsigned>(_mm_movemask_epi8(ws)) & 0xFFFF;
+					if (m)
+						return s + first(m);
+				}
+#endif
+				while (s != e && is_space(*s))
+					++s;
 
-		inline json::value read_value(std::istream& is);
+				return s;
+			}
+			// first quote q or backslash in [s, e)
+			inline const char* find_quote(char q, const char* s, const char* e)
+			{
+#ifdef JSON_AVX2
+				const __m256i qq = _mm256_set1_epi8(q), bs = _mm256_set1_epi8('\\');
+				for (; e - s >= 32; s += 32) {
+					__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+					unsigned m = static_cast<unsigned>(_mm256_movemask_epi8(
+						_mm256_or_si256(_mm256_cmpeq_epi8(x, qq), _mm256_cmpeq_epi8(x, bs))));
+					if (m)
+						return s + first(m);
+				}
+#endif
+#ifdef JSON_SSE2
+				const __m128i qq_ = _mm_set1_epi8(q), bs_ = _mm_set1_epi8('\\');
+				for (; e - s >= 16; s += 16) {
+					__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+					unsigned m = static_cast<unsigned>(_mm_movemask_epi8(
+						_mm_or_si128(_mm_cmpeq_epi8(x, qq_), _mm_cmpeq_epi8(x, bs_))));
+					if (m)
+						return s + first(m);
+				}
+#endif
+				while (s != e && *s != q && *s != '\\')
+					++s;
 
-		inline json::value read_array(std::istream& is)
-		{
-			json::value v;
+				return s;
+			}
+			// first character in [s, e) that needs escaping in a JSON string:
+			// a quote, a backslash or a control character
+			inline const char* find_escape(const char* s, const char* e)
+			{
+#ifdef JSON_AVX2
+				const __m256i qq = _mm256_set1_epi8('"'), bs = _mm256_set1_epi8('\\'), us = _mm256_set1_epi8(0x1F);
+				for (; e - s >= 32; s += 32) {
+					__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+					__m256i m = _mm256_or_si256(
+						_mm256_or_si256(_mm256_cmpeq_epi8(x, qq), _mm256_cmpeq_epi8(x, bs)),
+						_mm256_cmpeq_epi8(_mm256_max_epu8(x, us), us));
+					unsigned k = static_cast<unsigned>(_mm256_movemask_epi8(m));
+					if (k)
+						return s + first(k);
+				}
+#endif
+#ifdef JSON_SSE2
+				const __m128i qq_ = _mm_set1_epi8('"'), bs_ = _mm_set1_epi8('\\'), us_ = _mm_set1_epi8(0x1F);
+				for (; e - s >= 16; s += 16) {
+					__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+					__m128i m = _mm_or_si128(
+						_mm_or_si128(_mm_cmpeq_epi8(x, qq_), _mm_cmpeq_epi8(x, bs_)),
+						_mm_cmpeq_epi8(_mm_max_epu8(x, us_), us_));
+					unsigned k = static_cast<unsigned>(_mm_movemask_epi8(m));
+					if (k)
+						return s + first(k);
+				}
+#endif
+				while (s != e && *s != '"' && *s != '\\' && static_cast<unsigned char>(*s) >= 0x20)
+					++s;
+
+				return s;
+			}
+			// first bracket or quote in [s, e), what an on demand document
+			// needs to see of the structure
+			inline const char* find_structure(const char* s, const char* e)
+			{
+#ifdef JSON_AVX2
+				const __m256i ob = _mm256_set1_epi8('{'), cb = _mm256_set1_epi8('}');
+				const __m256i os = _mm256_set1_epi8('['), cs = _mm256_set1_epi8(']');
+				const __m256i dq = _mm256_set1_epi8('"'), sq = _mm256_set1_epi8('\'');
+				for (; e - s >= 32; s += 32) {
+					__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+					__m256i m = _mm256_or_si256(
+						_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x, ob), _mm256_cmpeq_epi8(x, cb)),
+							_mm256_or_si256(_mm256_cmpeq_epi8(x, os), _mm256_cmpeq_epi8(x, cs))),
+						_mm256_or_si256(_mm256_cmpeq_epi8(x, dq), _mm256_cmpeq_epi8(x, sq)));
+					unsigned k = static_cast<unsigned>(_mm256_movemask_epi8(m));
+					if (k)
+						return s + first(k);
+				}
+#endif
+#ifdef JSON_SSE2
+				const __m128i ob_ = _mm_set1_epi8('{'), cb_ = _mm_set1_epi8('}');
+				const __m128i os_ = _mm_set1_epi8('['), cs_ = _mm_set1_epi8(']');
+				const __m128i dq_ = _mm_set1_epi8('"'), sq_ = _mm_set1_epi8('\'');
+				for (; e - s >= 16; s += 16) {
+					__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+					__m128i m = _mm_or_si128(
+						_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, ob_), _mm_cmpeq_epi8(x, cb_)),
+							_mm_or_si128(_mm_cmpeq_epi8(x, os_), _mm_cmpeq_epi8(x, cs_))),
+						_mm_or_si128(_mm_cmpeq_epi8(x, dq_), _mm_cmpeq_epi8(x, sq_)));
+					unsigned k = static_cast<unsigned>(_mm_movemask_epi8(m));
+					if (k)
+						return s + first(k);
+				}
+#endif
+				while (s != e && *s != '{' && *s != '}' && *s != '[' && *s != ']' && *s != '"' && *s != '\'')
+					++s;
 
-			while (json::value a = read_value(is)) {
-				v.push_back(a);
+				return s;
 			}
+		} // namespace scan
 
-			return v;
-		}
-		inline std::string read_string(std::istream& is)
-		{
-			char c;
-			std::string s;
+		//
+		// streaming parser
+		//
 
-			for (is >> c; c != '\"' && c != '\''; is >> c)
-				s += c; // does not handle escaped quotes!!!
-			
-			return s;
-		}
-		inline json::value read_value(std::istream& is)
-		{
-			char c;
-			json::value v;
+		// SAX style events, override the ones of interest in a derived class
+		// returning false from an event stops the parser
+		// strings are only valid during the call unless flags has JSON_BORROWED,
+		// then they point into the buffer given to feed
+		// integers that fit are sent to integer, handlers that do not
+		// declare it get them as doubles through number
+		struct handler {
+			bool null() { return true; }
+			bool boolean(bool) { return true; }
+			bool number(double) { return true; }
+			bool integer(int64_t) { return true; }
+			bool string(const json::string&, unsigned char /* flags */) { return true; }
+			bool key(const json::string&) { return true; }
+			bool start_object() { return true; }
+			bool end_object() { return true; }
+			bool start_array() { return true; }
+			bool end_array() { return true; }
+		};
 
-			is >> std::skipws >> c;
+		// resumable push parser, input is fed in chunks of any size and tokens
+		// split between chunks are carried over, nesting is kept on an explicit
+		// stack so depth is only limited by memory
+		// top level values may follow one another, as in newline delimited files
+		// in raw mode escaped strings are passed undecoded with JSON_ESCAPED set
+		template<class Handler>
+		class stream {
+		public:
+			stream(Handler& h, bool raw = false)
+				: h(h), raw(raw), state(VALUE), stopped(false), failed(false), s(0), e(0)
+			{ }
 
-			if (c == ']' || c == '}') {
-				return v;
-			}
+			// false once the handler has stopped the parser or on a syntax error
+			bool feed(const char* buf, size_t len)
+			{
+				s = buf;
+				e = buf + len;
+				if (stopped)
+					return false;
 
-			if (c == ',') {
-				is >> std::skipws >> c;
-			}
+				switch (state) {
+				case STRING:
+					if (!resume_string())
+						return !stopped;
+					break;
+				case NUMBER:
+					if (!resume_number())
+						return !stopped;
+					break;
+				case LITERAL:
+					if (!resume_literal())
+						return !stopped;
+					break;
+				default:
+					break;
+				}
 
-			if (c == '[') {
-				v = read_array(is);
+				return run();
 			}
-			else if (c == '\"' || c == '\'')
-				v = read_string(is).c_str();
-			else if (c == 'f') {
-				ensure (eat('a', is));
-				ensure (eat('l', is));
-				ensure (eat('s', is));
-				ensure (eat('e', is));
-				v = false;
+			// end of input, completes a trailing top level number
+			bool finish()
+			{
+				if (stopped)
+					return !failed;
+				if (state == NUMBER) {
+					number(pending.data(), pending.size());
+					if (stopped)
+						return !failed;
+				}
+				if (state != VALUE || !nest.empty())
+					return fail();
+
+				return true;
 			}
-			else if (c == 't') {
-				ensure (eat('r', is));
-				ensure (eat('u', is));
-				ensure (eat('e', is));
-				v = true;
+
+			bool error() const
+			{
+				return failed;
 			}
-			else if (c == 'n') {
-				ensure (eat('u', is));
-				ensure (eat('l', is));
-				ensure (eat('l', is));
-				v.type = JSON_NULL;
+			// open objects and arrays
+			size_t depth() const
+			{
+				return nest.size();
 			}
-			else {
-				is.putback(c);
-				is >> v.data.number;
-				ensure (!is.fail());
-				v.type = JSON_NUMBER;
+			// first unread character of the last chunk
+			const char* position() const
+			{
+				return s;
 			}
 
-			return v;
-		}
-		inline std::string read_key(std::istream& is)
-		{
-			std::string key = read_string(is);
+		private:
+			enum state_t {
+				VALUE, ARRAY_FIRST, OBJECT_FIRST, KEY, COLON, NEXT, // between tokens
+				STRING, NUMBER, LITERAL // inside a token that ran off the chunk
+			};
 
-			ensure (parse::eat(':', is));
+			Handler& h;
+			bool raw;
+			state_t state;
+			bool stopped;
+			bool failed;
+			const char* s;
+			const char* e;
+			std::vector<char> nest; // '{' or '[' per open container
 
-			return key;
-		}
-		inline bool read_pair(std::istream& is, std::pair<std::string,json::value>& kv)
-		{
-			char c;
-			is >> std::skipws >> c;
+			// token carried over between chunks
+			std::string pending;
+			std::string scratch; // unescaped strings
+			char quote;
+			bool in_key;
+			bool escaped;
+			bool backslash; // chunk ended inside an escape
+			const char* literal;
+			size_t matched;
+
+			bool run()
+			{
+				while (!stopped) {
+					if (s != e && scan::is_space(*s))
+						s = scan::skip_space(s, e);
+					if (s == e)
+						return true;
+
+					char c = *s;
+					switch (state) {
+					case ARRAY_FIRST:
+						if (c == ']') {
+							++s;
+							close('[');
+							break;
+						}
+						// fall through
+					case VALUE:
+						value(c);
+						break;
+					case OBJECT_FIRST:
+						if (c == '}') {
+							++s;
+							close('{');
+							break;
+						}
+						// fall through
+					case KEY:
+						if (c != '\"' && c != '\'')
+							return fail();
+						++s;
+						begin_string(c, true);
+						break;
+					case COLON:
+						if (c != ':')
+							return fail();
+						++s;
+						state = VALUE;
+						break;
+					case NEXT:
+						++s;
+						if (c == ',')
+							state = nest.back() == '[' ? VALUE : KEY;
+						else if (c == ']' || c == '}')
+							close(c == ']' ? '[' : '{');
+						else
+							return fail();
+						break;
+					default:
+						return fail();
+					}
+				}
 
-			if (c == '}') {
 				return false;
 			}
+			// reported by feed and error(), read_value and friends assert on it
+			bool fail()
+			{
+				failed = stopped = true;
 
-			ensure (c == '\"' || c == '\'');
-			kv.first = read_key(is);
-			kv.second = read_value(is);
+				return false;
+			}
+			void done()
+			{
+				state = nest.empty() ? VALUE : NEXT;
+			}
+			void close(char open)
+			{
+				if (nest.empty() || nest.back() != open) {
+					fail();
+					return;
+				}
+				nest.pop_back();
+				done();
+				if (!(open == '{' ? h.end_object() : h.end_array()))
+					stopped = true;
+			}
+			void value(char c)
+			{
+				switch (c) {
+				case '{':
+					++s;
+					nest.push_back('{');
+					state = OBJECT_FIRST;
+					if (!h.start_object())
+						stopped = true;
+					break;
+				case '[':
+					++s;
+					nest.push_back('[');
+					state = ARRAY_FIRST;
+					if (!h.start_array())
+						stopped = true;
+					break;
+				case '\"': case '\'':
+					++s;
+					begin_string(c, false);
+					break;
+				case 't':
+					begin_literal("true");
+					break;
+				case 'f':
+					begin_literal("false");
+					break;
+				case 'n':
+					begin_literal("null");
+					break;
+				default:
+					begin_number();
+				}
+			}
+
+			// after the opening quote, false with s at e if the chunk ends first
+			bool string_body(const char*& end)
+			{
+				for (;;) {
+					s = scan::find_quote(quote, s, e);
+					if (s == e)
+						return false;
+					if (*s == quote) {
+						end = s++;
+						return true;
+					}
+					escaped = true;
+					if (e - s < 2) {
+						s = e;
+						backslash = true;
+						return false;
+					}
+					s += 2;
+				}
+			}
+			void begin_string(char q, bool key)
+			{
+				const char* b = s;
+				const char* end;
+
+				quote = q;
+				in_key = key;
+				escaped = backslash = false;
+				if (string_body(end)) {
+					string(b, end - b, true);
+				}
+				else {
+					pending.assign(b, e);
+					state = STRING;
+				}
+			}
+			bool resume_string()
+			{
+				if (backslash) {
+					if (s == e)
+						return false;
+					pending += *s++;
+					backslash = false;
+				}
+
+				const char* b = s;
+				const char* end;
+				bool complete = string_body(end);
+
+				pending.append(b, complete ? end : e);
+				if (complete)
+					string(pending.data(), pending.size(), false);
+
+				return complete;
+			}
+			// borrowed if p points into the current chunk
+			void string(const char* p, size_t n, bool borrowed)
+			{
+				json::string str = string_(n, p);
+				unsigned char flags = borrowed ? JSON_BORROWED : JSON_OWNED;
+
+				if (escaped && (in_key || !raw)) {
+					scratch.clear();
+					for (const char* q = p, *end = p + n; q != end; ) {
+						const char* b = q;
+						while (q != end && *q != '\\')
+							++q;
+						scratch.append(b, q);
+						if (q != end)
+							q = json::unescape(q, end, scratch);
+					}
+					str = string_(scratch.size(), scratch.data());
+					flags = JSON_OWNED;
+				}
+				else if (escaped) {
+					flags |= JSON_ESCAPED;
+				}
+
+				if (in_key) {
+					state = COLON;
+					if (!h.key(str))
+						stopped = true;
+				}
+				else {
+					done();
+					if (!h.string(str, flags))
+						stopped = true;
+				}
+			}
+
+			static bool number_char(char c)
+			{
+				return isdigit(static_cast<unsigned char>(c)) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+			}
+			void begin_number()
+			{
+				const char* b = s;
+
+				while (s != e && number_char(*s))
+					++s;
+				if (s == e) {
+					pending.assign(b, e);
+					state = NUMBER;
+				}
+				else {
+					number(b, s - b);
+				}
+			}
+			bool resume_number()
+			{
+				const char* b = s;
+
+				while (s != e && number_char(*s))
+					++s;
+				pending.append(b, s);
+				if (s == e)
+					return false;
+				number(pending.data(), pending.size());
+
+				return true;
+			}
+			void number(const char* p, size_t n)
+			{
+				json::element x;
+
+				if (!read_number(p, n, x)) {
+					fail();
+					return;
+				}
+
+				done();
+#ifndef JSON_ONLY
+				if (x.type == JSON_INT64 ? !integer(h, x.data.int64, &Handler::integer) : !h.number(x.data.number))
+#else
+				if (!h.number(x.data.number))
+#endif
+					stopped = true;
+			}
+			// handlers without their own integer get doubles
+			template<class H>
+			static bool integer(H& h, int64_t i, bool (handler::*)(int64_t))
+			{
+				return h.number(static_cast<double>(i));
+			}
+			template<class H, class C>
+			static bool integer(H& h, int64_t i, bool (C::*)(int64_t))
+			{
+				return h.integer(i);
+			}
+
+			void begin_literal(const char* l)
+			{
+				literal = l;
+				matched = 0;
+				if (!resume_literal())
+					state = LITERAL;
+			}
+			bool resume_literal()
+			{
+				while (literal[matched] && s != e) {
+					if (*s != literal[matched]) {
+						fail();
+						return true;
+					}
+					++s;
+					++matched;
+				}
+				if (literal[matched])
+					return false;
+
+				done();
+				bool go;
+				switch (literal[0]) {
+				case 't': go = h.boolean(true); break;
+				case 'f': go = h.boolean(false); break;
+				default: go = h.null();
+				}
+				if (!go)
+					stopped = true;
+
+				return true;
+			}
+		};
+
+		// handler building a json::value on the heap, in an arena if a is
+		// not null or owned by a memory m, and stopping after the first top
+		// level value
+		// in view mode string values are borrowed from the input, which
+		// must then be given in one chunk and outlive the tree
+		class builder : public handler {
+		public:
+			builder(json::arena* a = 0, bool view = false)
+				: a(a), m(0), view_(view), complete_(false)
+			{ }
+			explicit builder(json::memory& m)
+				: a(0), m(&m == &json::heap() ? 0 : &m), view_(false), complete_(false)
+			{ }
+			~builder()
+			{
+				// anything left from an interrupted parse
+				for (size_t i = 0; i < stack.size(); ++i)
+					discard(stack[i]);
+				for (size_t i = 0; i < frames.size(); ++i) {
+					if (frames[i].o) {
+						json::element e;
+						e.type = JSON_OBJECT;
+						e.flags = object_flags();
+						e.data.object = frames[i].o;
+						discard(e);
+					}
+				}
+			}
+
+			bool view() const
+			{
+				return view_;
+			}
+			// true once a whole value has been read
+			bool complete() const
+			{
+				return complete_;
+			}
+			json::value& value()
+			{
+				return root;
+			}
+
+			bool null()
+			{
+				json::element e;
+
+				e.type = JSON_NULL;
+
+				return add(e);
+			}
+			bool boolean(bool b)
+			{
+				json::element e;
+
+				e.type = b ? JSON_TRUE : JSON_FALSE;
+
+				return add(e);
+			}
+			bool number(double d)
+			{
+				json::element e;
+
+				e.type = JSON_NUMBER;
+				e.data.number = d;
+
+				return add(e);
+			}
+#ifndef JSON_ONLY
+			bool integer(int64_t i)
+			{
+				json::element e;
+
+				e.type = JSON_INT64;
+				e.data.int64 = i;
+
+				return add(e);
+			}
+#endif
+			bool string(const json::string& s, unsigned char flags)
+			{
+				json::value v;
+
+				if (view_ && (flags & JSON_BORROWED)) {
+					v.type = JSON_STRING;
+					v.flags = flags;
+					v.data.string = s;
+				}
+				else if (a) {
+					v.construct_string(s.data, s.size, *a);
+				}
+				else {
+					m ? v.construct_string(s.data, s.size, *m) : v.construct_string(s.data, s.size);
+				}
+
+				return add(release(v));
+			}
+			bool key(const json::string& k)
+			{
+				keys[frames.size() - 1].assign(k.data, k.size);
+
+				return true;
+			}
+			bool start_object()
+			{
+				if (a) {
+					frames.push_back(frame(a->create<json::object>(json::object::allocator_type(a))));
+				}
+				else if (m) {
+					json::value v;
+					v.construct_object(*m);
+					frames.push_back(frame(release(v).data.object));
+				}
+				else {
+					frames.push_back(frame(new json::object));
+					json::allocated(sizeof(json::object));
+				}
+				if (keys.size() < frames.size())
+					keys.resize(frames.size());
+
+				return true;
+			}
+			bool end_object()
+			{
+				json::element e;
+
+				e.type = JSON_OBJECT;
+				e.flags = object_flags();
+				e.data.object = frames.back().o;
+				frames.pop_back();
+#ifdef JSON_FLAT_OBJECT
+				// duplicates are dropped by reindex
+				e.data.object->reindex();
+#endif
+				return add(e);
+			}
+			// elements are collected on a stack and moved into an exactly sized array
+			bool start_array()
+			{
+				frames.push_back(frame(0, stack.size()));
+
+				return true;
+			}
+			bool end_array()
+			{
+				size_t base = frames.back().base;
+				size_t n = stack.size() - base;
+				json::value v;
+
+				frames.pop_back();
+				if (a)
+					v.construct_array(n, *a);
+				else
+					m ? v.construct_array(n, *m) : v.construct_array(n);
+				if (n)
+					memcpy(v.data.array.element, &stack[base], n*sizeof(json::element));
+				stack.resize(base);
+
+				return add(release(v));
+			}
+
+		private:
+			struct frame {
+				frame(json::object* o, size_t base = 0)
+					: o(o), base(base)
+				{ }
+
+				json::object* o; // null for arrays
+				size_t base; // first element of an array on the stack
+			};
+
+			json::arena* a;
+			json::memory* m;
+			bool view_;
+			bool complete_;
+			json::value root;
+			std::vector<frame> frames;
+			std::vector<std::string> keys; // pending key per depth
+			std::vector<json::element> stack; // pending array elements
+
+			// the payload passes to the caller
+			static json::element release(json::value& v)
+			{
+				json::element e = v;
+
+				v.type = JSON_UNDEFINED;
+
+				return e;
+			}
+			unsigned char object_flags() const
+			{
+				return a ? JSON_BORROWED : m ? JSON_MEMORY : JSON_OWNED;
+			}
+			static void discard(const json::element& e)
+			{
+				json::value v;
+
+				static_cast<json::element&>(v) = e;
+			}
+			bool add(const json::element& e)
+			{
+				if (frames.empty()) {
+					static_cast<json::element&>(root) = e;
+					complete_ = true;
+
+					return false;
+				}
+
+				frame& f = frames.back();
+				if (!f.o) {
+					stack.push_back(e);
+					return true;
+				}
+
+				const std::string& k = keys[frames.size() - 1];
+#ifdef JSON_FLAT_OBJECT
+				static_cast<json::element&>(f.o->append(k)) = e;
+#else
+				// first key wins, like std::map::insert
+				std::pair<json::object::iterator,bool> i = f.o->insert(std::make_pair(k, json::value()));
+				if (i.second)
+					static_cast<json::element&>(i.first->second) = e;
+				else
+					discard(e);
+#endif
+				return true;
+			}
+		};
+
+		// one value from a contiguous buffer that need not be null terminated,
+		// false and b left empty unless the value is whole and only space
+		// follows it
+		inline bool read_one(builder& b, const char* buf, size_t len)
+		{
+			stream<builder> p(b, b.view());
+
+			if (p.feed(buf, len))
+				p.finish();
+			if (b.complete() && !p.error() && scan::skip_space(p.position(), buf + len) == buf + len)
+				return true;
+			json::value().swap(b.value());
+
+			return false;
+		}
+		// as read_one, asserting the input is well formed
+		inline bool build(builder& b, const char* buf, size_t len)
+		{
+			if (read_one(b, buf, len))
+				return true;
+			ensure (!"malformed json or text after the value");
+
+			return false;
+		}
+		// one value from is, read in the chunks its buffer holds, with what
+		// follows the value left in the stream, failbit set on an error
+		inline bool build(builder& b, std::istream& is)
+		{
+			stream<builder> p(b);
+			std::streambuf* sb = is.rdbuf();
+			char buf[4096];
+
+			for (;;) {
+				std::streamsize n = sb ? sb->in_avail() : -1;
+				if (n > 0) {
+					n = sb->sgetn(buf, std::min(n, static_cast<std::streamsize>(sizeof(buf))));
+				}
+				else {
+					int c = sb ? sb->sbumpc() : EOF;
+					if (c == EOF) {
+						is.setstate(std::ios::eofbit);
+						p.finish();
+						break;
+					}
+					buf[0] = static_cast<char>(c);
+					n = 1;
+				}
+				if (!p.feed(buf, static_cast<size_t>(n)) || b.complete()) {
+					// give back what was read past the value, it is still buffered
+					for (const char* q = p.position(); q != buf + n; ++q)
+						sb->sungetc();
+					break;
+				}
+			}
+			if (b.complete() && !p.error())
+				return true;
+			json::value().swap(b.value());
+			is.setstate(std::ios::failbit);
+
+			return false;
+		}
+		inline json::value take_value(builder& b)
+		{
+			json::value v;
+
+			v.swap(b.value());
+
+			return v;
+		}
+		inline object take_object(builder& b)
+		{
+			object o;
+
+			ensure (b.value().type == JSON_OBJECT);
+			if (b.value().type == JSON_OBJECT)
+				o.swap(*b.value().data.object);
+
+			return o;
+		}
+		inline object& arena_object(builder& b, json::arena& a)
+		{
+			ensure (b.value().type == JSON_OBJECT);
+			if (b.value().type != JSON_OBJECT)
+				return *a.create<object>(object::allocator_type(&a));
+
+			return *b.value().data.object;
+		}
+
+		inline json::value read_value(const char* buf, size_t len)
+		{
+			builder b;
+
+			build(b, buf, len);
+
+			return take_value(b);
+		}
+		inline object read_object(const char* buf, size_t len)
+		{
+			builder b;
+
+			build(b, buf, len);
+
+			return take_object(b);
+		}
+		// the tree is valid until a is reset or destroyed
+		inline json::value read_value(const char* buf, size_t len, json::arena& a)
+		{
+			builder b(&a);
+
+			build(b, buf, len);
+
+			return take_value(b);
+		}
+		inline object& read_object(const char* buf, size_t len, json::arena& a)
+		{
+			builder b(&a);
+
+			build(b, buf, len);
+
+			return arena_object(b, a);
+		}
+		// the tree and the members of its objects come from m, which must
+		// outlive them
+		inline json::value read_value(const char* buf, size_t len, json::memory& m)
+		{
+			builder b(m);
+
+			build(b, buf, len);
+
+			return take_value(b);
+		}
+		inline object read_object(const char* buf, size_t len, json::memory& m)
+		{
+			builder b(m);
+
+			build(b, buf, len);
+
+			ensure (b.value().type == JSON_OBJECT);
+			if (b.value().type != JSON_OBJECT)
+				return object(object::allocator_type(&m));
+
+			// a move keeps the allocator, a swap would not
+			return std::move(*b.value().data.object);
+		}
+		// string values point into buf, which must outlive the tree
+		inline json::value view_value(const char* buf, size_t len)
+		{
+			builder b(0, true);
+
+			build(b, buf, len);
+
+			return take_value(b);
+		}
+		inline object view_object(const char* buf, size_t len)
+		{
+			builder b(0, true);
+
+			build(b, buf, len);
+
+			return take_object(b);
+		}
+		inline json::value view_value(const char* buf, size_t len, json::arena& a)
+		{
+			builder b(&a, true);
+
+			build(b, buf, len);
+
+			return take_value(b);
+		}
+		inline object& view_object(const char* buf, size_t len, json::arena& a)
+		{
+			builder b(&a, true);
+
+			build(b, buf, len);
+
+			return arena_object(b, a);
+		}
+
+		// one value from a stream, undefined with failbit set on an error
+		inline json::value read_value(std::istream& is)
+		{
+			builder b;
+
+			build(b, is);
+
+			return take_value(b);
+		}
+		inline object read_object(std::istream& is)
+		{
+			builder b;
+
+			if (build(b, is) && b.value().type != JSON_OBJECT)
+				is.setstate(std::ios::failbit);
+
+			return b.value().type == JSON_OBJECT ? take_object(b) : object();
+		}
+
+		//
+		// pull parser
+		//
+
+		// Reads a whole buffer in the order the caller asks for values, for
+		// decoding into types known up front. Keys are borrowed from the
+		// buffer unless escaped, so only the strings asked for allocate.
+		// A call that finds something else fails and ends the input.
+		class reader {
+		public:
+			reader(const char* buf, size_t len)
+				: s(buf), e(buf + len), failed(false)
+			{ }
+
+			bool error() const
+			{
+				return failed;
+			}
+			// nothing but space left
+			bool done()
+			{
+				return !failed && scan::skip_space(s, e) == e;
+			}
+			// next character that is not space, 0 at the end
+			char peek()
+			{
+				s = scan::skip_space(s, e);
+
+				return s != e ? *s : 0;
+			}
+
+			bool begin_object()
+			{
+				return expect('{');
+			}
+			bool begin_array()
+			{
+				return expect('[');
+			}
+			// true if another member or element follows, false at the closing
+			// bracket or on an error, first is true before the first one
+			bool more(char close, bool& first)
+			{
+				if (peek() == close) {
+					++s;
+					return false;
+				}
+				if (!first && !expect(','))
+					return false;
+				first = false;
+
+				return true;
+			}
+			// key and colon, valid until the next key
+			bool key(json::string& k)
+			{
+				return string(k) && expect(':');
+			}
+
+			bool null()
+			{
+				return literal("null");
+			}
+			bool boolean(bool& b)
+			{
+				b = peek() == 't';
+
+				return literal(b ? "true" : "false");
+			}
+			// a number as read_number gives it, JSON_INT64 or JSON_NUMBER
+			bool number(json::element& x)
+			{
+				const char* b = s = scan::skip_space(s, e);
+
+				while (s != e && number_char(*s))
+					++s;
+
+				return read_number(b, s - b, x) || fail();
+			}
+			bool string(std::string& str)
+			{
+				json::string t;
+
+				if (!string(t))
+					return false;
+				str.assign(t.data, t.size);
+
+				return true;
+			}
+			// any value, brackets are matched on an explicit stack rather
+			// than by recursion, commas and colons inside are not checked
+			bool skip()
+			{
+				std::string open;
+				json::string t;
+				json::element x;
+				bool b;
+
+				do {
+					switch (peek()) {
+					case '{': open += '}'; ++s; continue;
+					case '[': open += ']'; ++s; continue;
+					case '}': case ']':
+						if (open.empty() || *s != open[open.size() - 1])
+							return fail();
+						open.erase(open.size() - 1);
+						++s;
+						break;
+					case ',': case ':':
+						if (open.empty())
+							return fail();
+						++s;
+						continue;
+					case '"': case '\'':
+						if (!string(t))
+							return false;
+						break;
+					case 't': case 'f':
+						if (!boolean(b))
+							return false;
+						break;
+					case 'n':
+						if (!null())
+							return false;
+						break;
+					default:
+						if (!number(x))
+							return false;
+					}
+				} while (!open.empty());
+
+				return true;
+			}
+
+		private:
+			const char* s;
+			const char* e;
+			bool failed;
+			std::string scratch; // escaped strings
+
+			bool fail()
+			{
+				failed = true;
+				s = e;
+
+				return false;
+			}
+			bool expect(char c)
+			{
+				if (peek() != c)
+					return fail();
+				++s;
+
+				return true;
+			}
+			bool literal(const char* l)
+			{
+				size_t n = strlen(l);
+
+				peek();
+				if (static_cast<size_t>(e - s) < n || memcmp(s, l, n))
+					return fail();
+				s += n;
+
+				return true;
+			}
+			static bool number_char(char c)
+			{
+				return isdigit(static_cast<unsigned char>(c)) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+			}
+			// borrowed when there is nothing to unescape
+			bool string(json::string& str)
+			{
+				char q = peek();
+
+				if (q != '"' && q != '\'')
+					return fail();
+
+				const char* b = ++s;
+				bool escaped = false;
+				for (;;) {
+					s = scan::find_quote(q, s, e);
+					if (s == e)
+						return fail();
+					if (*s == q)
+						break;
+					if (e - s < 2)
+						return fail();
+					escaped = true;
+					s += 2;
+				}
+
+				str = string_(s - b, b);
+				if (escaped) {
+					scratch.clear();
+					for (const char* p = b; p != s; ) {
+						const char* r = p;
+						while (p != s && *p != '\\')
+							++p;
+						scratch.append(r, p);
+						if (p != s)
+							p = json::unescape(p, s, scratch);
+					}
+					str = string_(scratch.size(), scratch.data());
+				}
+				++s;
+
+				return true;
+			}
+		};
+
+		//
+		// on demand
+		//
+
+		class lazy;
+
+		// A buffer checked once for balanced brackets and closed strings,
+		// keeping where each bracket closes so values can be stepped over
+		// without reading them. Nothing is decoded until a lazy value is
+		// asked for it, numbers and literals are only checked then. The
+		// buffer must outlive the document and its values; reading another
+		// buffer into the same document reuses its storage.
+		class document {
+		public:
+			document()
+				: b(0), e(0), failed(true)
+			{ }
+			document(const char* buf, size_t len)
+			{
+				read(buf, len);
+			}
+
+			bool read(const char* buf, size_t len)
+			{
+				b = buf;
+				e = buf + len;
+				failed = false;
+				open.clear();
+				close.clear();
+				stack.clear();
+
+				for (const char* p = b; (p = scan::find_structure(p, e)) != e; ) {
+					char c = *p;
+					if (c == '"' || c == '\'') {
+						// strings follow a bracket, comma or colon, a quote
+						// after anything else is inside a bare token
+						const char* q = p;
+						while (q != b && scan::is_space(q[-1]))
+							--q;
+						if (q != b && q[-1] != '{' && q[-1] != '[' && q[-1] != ',' && q[-1] != ':')
+							return fail();
+						p = end_string(p);
+						if (!p)
+							return fail();
+					}
+					else if (c == '{' || c == '[') {
+						stack.push_back(open.size());
+						open.push_back(p - b);
+						close.push_back(0);
+						++p;
+					}
+					else {
+						if (stack.empty() || b[open[stack.back()]] != (c == '}' ? '{' : '['))
+							return fail();
+						close[stack.back()] = p - b;
+						stack.pop_back();
+						++p;
+					}
+				}
+				if (!stack.empty())
+					return fail();
+
+				return true;
+			}
+			bool error() const
+			{
+				return failed;
+			}
+			// the top level value, empty on an error
+			inline lazy root() const;
+
+			// just past the value starting at p, 0 if it is not well formed
+			const char* skip(const char* p) const
+			{
+				switch (*p) {
+				case '{': case '[': {
+					std::vector<size_t>::const_iterator i = std::lower_bound(open.begin(), open.end(), static_cast<size_t>(p - b));
+					if (i == open.end() || *i != static_cast<size_t>(p - b))
+						return 0;
+					return b + close[i - open.begin()] + 1;
+				}
+				case '"': case '\'':
+					return end_string(p);
+				default:
+					while (p != e && *p != ',' && *p != '}' && *p != ']' && !scan::is_space(*p)) {
+						if (*p == '"' || *p == '\'')
+							return 0;
+						++p;
+					}
+					return p;
+				}
+			}
+			const char* end() const
+			{
+				return e;
+			}
+			// just past the string whose opening quote is at p
+			const char* end_string(const char* p) const
+			{
+				char q = *p++;
+
+				for (;;) {
+					p = scan::find_quote(q, p, e);
+					if (p == e || (*p == '\\' && e - p < 2))
+						return 0;
+					if (*p == q)
+						return p + 1;
+					p += 2;
+				}
+			}
+
+		private:
+			const char* b;
+			const char* e;
+			bool failed;
+			std::vector<size_t> open, close; // offsets of bracket pairs, in order of opening
+			std::vector<size_t> stack;       // pairs not yet closed
+
+			bool fail()
+			{
+				failed = true;
+				open.clear();
+				close.clear();
+
+				return false;
+			}
+		};
+
+		// A value in a document, read only when asked. Members are found by
+		// stepping over the values before them, so a key lookup costs the
+		// keys ahead of it rather than the whole object. Use value() to
+		// decode a subtree into a json::value.
+		class lazy_iterator;
+		class lazy {
+			friend class lazy_iterator;
+		public:
+			typedef lazy_iterator iterator;
+
+			lazy()
+				: d(0), s(0)
+			{ }
+			lazy(const document* d, const char* s)
+				: d(d), s(s != d->end() ? s : 0)
+			{ }
+
+			// false if missing or not found
+			operator bool() const
+			{
+				return s != 0;
+			}
+			// from the first character, JSON_NUMBER for anything unquoted
+			// that is not a literal, JSON_UNDEFINED if missing
+			json_element_type type() const
+			{
+				if (!s)
+					return JSON_UNDEFINED;
+				switch (*s) {
+				case '{': return JSON_OBJECT;
+				case '[': return JSON_ARRAY;
+				case '"': case '\'': return JSON_STRING;
+				case 't': return JSON_TRUE;
+				case 'f': return JSON_FALSE;
+				case 'n': return JSON_NULL;
+				default: return JSON_NUMBER;
+				}
+			}
+			// the text of the value, quotes and brackets included
+			json::string raw() const
+			{
+				const char* t = s ? d->skip(s) : 0;
+
+				return t ? string_(t - s, s) : string_();
+			}
+
+			// members or elements in order
+			inline iterator begin() const;
+			inline iterator end() const;
+
+			// member by key, empty if there is none or this is not an object
+			inline lazy find(const json::string& k) const;
+			lazy operator[](const char* k) const
+			{
+				return find(string_(strlen(k), k));
+			}
+			lazy operator[](const std::string& k) const
+			{
+				return find(string_(k.size(), k.data()));
+			}
+			// element i, empty if out of range or this is not an array
+			inline lazy operator[](size_t i) const;
+			lazy operator[](int i) const
+			{
+				return i < 0 ? lazy() : operator[](static_cast<size_t>(i));
+			}
+
+			// decode a scalar, false if it is something else
+			bool get(bool& b) const
+			{
+				json_element_type t = type();
+
+				b = t == JSON_TRUE;
+				if (t != JSON_TRUE && t != JSON_FALSE)
+					return false;
+				json::string r = raw();
+
+				return b ? r.size == 4 && 0 == memcmp(r.data, "true", 4)
+					: r.size == 5 && 0 == memcmp(r.data, "false", 5);
+			}
+			// JSON_INT64 or JSON_NUMBER, as read_number gives it
+			bool get(json::element& x) const
+			{
+				json::string t = raw();
+
+				return type() == JSON_NUMBER && t.size && read_number(t.data, t.size, x);
+			}
+			bool get(double& n) const
+			{
+				json::element x;
+
+				if (!get(x))
+					return false;
+#ifndef JSON_ONLY
+				n = x.type == JSON_INT64 ? static_cast<double>(x.data.int64) : x.data.number;
+#else
+				n = x.data.number;
+#endif
+				return true;
+			}
+			bool get(std::string& str) const
+			{
+				json::string t = raw();
+
+				if (type() != JSON_STRING || !t.size)
+					return false;
+				t = string_(t.size - 2, t.data + 1);
+				if (std::find(t.data, t.data + t.size, '\\') != t.data + t.size)
+					str = json::unescape(t);
+				else
+					str.assign(t.data, t.size);
+
+				return true;
+			}
+
+			// the whole subtree as a tree
+			json::value value() const
+			{
+				json::string t = raw();
+
+				return t.size ? parse::read_value(t.data, t.size) : json::value();
+			}
+			json::value value(json::arena& a) const
+			{
+				json::string t = raw();
+
+				return t.size ? parse::read_value(t.data, t.size, a) : json::value();
+			}
+
+		private:
+			const document* d;
+			const char* s; // first character, 0 if missing
+		};
+
+		// a member of an object or an element of an array, whose key is
+		// empty, keys are left escaped if escaped is set
+		struct lazy_member {
+			json::string key;
+			bool escaped;
+			lazy value;
+		};
+
+		class lazy_iterator {
+		public:
+			typedef std::forward_iterator_tag iterator_category;
+			typedef lazy_member value_type;
+			typedef ptrdiff_t difference_type;
+			typedef const lazy_member* pointer;
+			typedef const lazy_member& reference;
+
+			lazy_iterator()
+				: d(0), p(0), object(false)
+			{
+				decode();
+			}
+			lazy_iterator(const document* d, const char* p, bool object)
+				: d(d), p(p), object(object)
+			{
+				decode();
+			}
+
+			const lazy_member& operator*() const { return m; }
+			const lazy_member* operator->() const { return &m; }
+			lazy_iterator& operator++()
+			{
+				// past the value and its comma, or to the end at the closing bracket
+				const char* q = d->skip(m.value.s);
+				q = q ? scan::skip_space(q, d->end()) : d->end();
+				p = q != d->end() && *q == ',' ? q + 1 : 0;
+				decode();
+
+				return *this;
+			}
+			lazy_iterator operator++(int)
+			{
+				lazy_iterator i(*this);
+
+				++*this;
+
+				return i;
+			}
+			bool operator==(const lazy_iterator& i) const { return p == i.p; }
+			bool operator!=(const lazy_iterator& i) const { return p != i.p; }
+
+		private:
+			const document* d;
+			const char* p; // start of the current member, 0 at the end
+			bool object;
+			lazy_member m;
+
+			void decode()
+			{
+				m.key = string_();
+				m.escaped = false;
+				m.value = lazy();
+				if (!p)
+					return;
+				p = scan::skip_space(p, d->end());
+				if (p == d->end() || *p == '}' || *p == ']') {
+					p = 0;
+					return;
+				}
+
+				const char* v = p;
+				if (object) {
+					const char* k = *p == '"' || *p == '\'' ? d->end_string(p) : 0;
+					if (k)
+						v = scan::skip_space(k, d->end());
+					if (!k || v == d->end() || *v != ':') {
+						p = 0;
+						return;
+					}
+					m.key = string_(k - p - 2, p + 1);
+					m.escaped = std::find(m.key.data, m.key.data + m.key.size, '\\') != m.key.data + m.key.size;
+					v = scan::skip_space(v + 1, d->end());
+				}
+				m.value = lazy(d, v);
+				if (!m.value)
+					p = 0;
+			}
+		};
+
+		inline lazy::iterator lazy::begin() const
+		{
+			json_element_type t = type();
+
+			return t == JSON_OBJECT || t == JSON_ARRAY ? iterator(d, s + 1, t == JSON_OBJECT) : iterator();
+		}
+		inline lazy::iterator lazy::end() const
+		{
+			return iterator();
+		}
+		inline lazy lazy::find(const json::string& k) const
+		{
+			if (type() != JSON_OBJECT)
+				return lazy();
+			for (iterator i = begin(); i != end(); ++i) {
+				if (i->escaped ? json::unescape(i->key) == std::string(k.data, k.size)
+					: i->key.size == k.size && !memcmp(i->key.data, k.data, k.size))
+					return i->value;
+			}
+
+			return lazy();
+		}
+		inline lazy lazy::operator[](size_t i) const
+		{
+			if (type() != JSON_ARRAY)
+				return lazy();
+			for (iterator j = begin(); j != end(); ++j, --i)
+				if (!i)
+					return j->value;
+
+			return lazy();
+		}
+
+		inline lazy document::root() const
+		{
+			return failed ? lazy() : lazy(this, scan::skip_space(b, e));
+		}
+
+	} // namespace parse
+
+	//
+	// writing
+	//
+
+	// Appends JSON text to a contiguous buffer that grows as needed.
+	// Values are written through begin_object/key/value style calls, so no
+	// tree is needed, or a whole tree at once with value. Strings are
+	// escaped, pretty mode puts members on their own indented lines.
+	class writer {
+		writer(const writer&);
+		writer& operator=(const writer&);
+	public:
+		explicit writer(bool pretty = false, int indent = 2)
+			: b(0), p(0), e(0), pretty(pretty), indent(indent), after_key(false)
+		{ }
+		~writer()
+		{
+			free(b);
+		}
+
+		const char* data() const { return b; }
+		size_t size() const { return p - b; }
+		std::string str() const { return std::string(b, p); }
+		// start over, keeping the storage
+		void clear()
+		{
+			p = b;
+			open.clear();
+			after_key = false;
+		}
+
+		writer& begin_object()
+		{
+			separate();
+			put('{');
+			open.push_back(1);
+
+			return *this;
+		}
+		writer& end_object()
+		{
+			return close('}');
+		}
+		writer& begin_array()
+		{
+			separate();
+			put('[');
+			open.push_back(1);
+
+			return *this;
+		}
+		writer& end_array()
+		{
+			return close(']');
+		}
+		writer& key(const json::string& k)
+		{
+			separate();
+			quoted(k.data, k.size);
+			put(':');
+			if (pretty)
+				put(' ');
+			after_key = true;
+
+			return *this;
+		}
+		writer& key(const char* k)
+		{
+			return key(string_(strlen(k), k));
+		}
+		writer& key(const std::string& k)
+		{
+			return key(string_(k.size(), k.data()));
+		}
+
+		writer& null()
+		{
+			separate();
+			append("null", 4);
+
+			return *this;
+		}
+		writer& boolean(bool t)
+		{
+			separate();
+			t ? append("true", 4) : append("false", 5);
+
+			return *this;
+		}
+		writer& number(double d)
+		{
+			separate();
+			p = reserve(32);
+			p += write_number(d, p);
+
+			return *this;
+		}
+		writer& integer(int64_t i)
+		{
+			separate();
+			p = reserve(32);
+			p += write_number(i, p);
+
+			return *this;
+		}
+		writer& string(const json::string& s)
+		{
+			separate();
+			quoted(s.data, s.size);
+
+			return *this;
+		}
+		writer& string(const char* s)
+		{
+			return string(string_(strlen(s), s));
+		}
+
+		// a whole tree, elements json has no text for are written as null
+		writer& value(const json::element& v)
+		{
+			switch (v.type) {
+			case JSON_STRING: {
+				std::string tmp;
+				string(text(v, tmp));
+				break;
+			}
+			case JSON_NUMBER: number(v.data.number); break;
+			case JSON_OBJECT: value(*v.data.object); break;
+			case JSON_ARRAY:
+				begin_array();
+				for (size_t i = 0; i < v.data.array.size; ++i)
+					value(v.data.array.element[i]);
+				end_array();
+				break;
+			case JSON_TRUE: boolean(true); break;
+			case JSON_FALSE: boolean(false); break;
+#ifndef JSON_ONLY
+			case JSON_BYTE: bytes(v.data.byte); break;
+			case JSON_INT32: integer(v.data.int32); break;
+			case JSON_INT64: integer(v.data.int64); break;
+			case JSON_DATE: integer(static_cast<int64_t>(v.data.date)); break;
+#endif
+			default: null();
+			}
+
+			return *this;
+		}
+		writer& value(const json::object& o)
+		{
+			begin_object();
+			for (json::object::const_iterator i = o.begin(); i != o.end(); ++i) {
+				key(i->first);
+				value(i->second);
+			}
+
+			return end_object();
+		}
+
+	private:
+		char* b;
+		char* p;
+		char* e;
+		bool pretty;
+		int indent;
+		bool after_key; // the next value follows a key
+		std::vector<char> open; // per open container, true until it has a member
+
+		// room for n more bytes at p
+		char* reserve(size_t n)
+		{
+			if (static_cast<size_t>(e - p) < n) {
+				size_t size = p - b, cap = e - b;
+				cap = cap + cap/2 > size + n ? cap + cap/2 : size + n + 256;
+				char* q = static_cast<char*>(realloc(b, cap));
+				if (!q)
+					throw std::bad_alloc();
+				b = q;
+				p = q + size;
+				e = q + cap;
+			}
+
+			return p;
+		}
+		void put(char c)
+		{
+			*reserve(1) = c;
+			++p;
+		}
+		void append(const char* s, size_t n)
+		{
+			memcpy(reserve(n), s, n);
+			p += n;
+		}
+		void newline()
+		{
+			char* q = reserve(1 + indent*open.size());
+
+			*q++ = '\n';
+			memset(q, ' ', indent*open.size());
+			p = q + indent*open.size();
+		}
+		// comma and line break before a value or key
+		void separate()
+		{
+			if (after_key) {
+				after_key = false;
+				return;
+			}
+			if (open.empty())
+				return;
+			if (!open.back())
+				put(',');
+			open.back() = 0;
+			if (pretty)
+				newline();
+		}
+		writer& close(char c)
+		{
+			ensure (!open.empty());
+			bool empty = open.back() != 0;
+
+			open.pop_back();
+			if (pretty && !empty)
+				newline();
+			put(c);
+
+			return *this;
+		}
+		// string in quotes with runs that need no escaping copied as they are
+		void quoted(const char* s, size_t n)
+		{
+			static const char hex[] = "0123456789abcdef";
+			const char* end = s + n;
+
+			put('"');
+			for (;;) {
+				const char* q = parse::scan::find_escape(s, end);
+				append(s, q - s);
+				if (q == end)
+					break;
+
+				char* r = reserve(6);
+				unsigned char c = static_cast<unsigned char>(*q);
+				*r++ = '\\';
+				switch (c) {
+				case '"': *r++ = '"'; break;
+				case '\\': *r++ = '\\'; break;
+				case '\b': *r++ = 'b'; break;
+				case '\f': *r++ = 'f'; break;
+				case '\n': *r++ = 'n'; break;
+				case '\r': *r++ = 'r'; break;
+				case '\t': *r++ = 't'; break;
+				default:
+					*r++ = 'u';
+					*r++ = '0';
+					*r++ = '0';
+					*r++ = hex[c >> 4];
+					*r++ = hex[c & 0xF];
+				}
+				p = r;
+				s = q + 1;
+			}
+			put('"');
+		}
+#ifndef JSON_ONLY
+		// base64 in a string
+		void bytes(const json::byte& v)
+		{
+			static const char digit[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+			const uint8_t* s = v.data;
+			size_t n = v.size;
+
+			separate();
+			char* r = reserve(2 + 4*((n + 2)/3));
+			*r++ = '"';
+			for (; n >= 3; s += 3, n -= 3) {
+				*r++ = digit[s[0] >> 2];
+				*r++ = digit[((s[0] & 3) << 4) | (s[1] >> 4)];
+				*r++ = digit[((s[1] & 0xF) << 2) | (s[2] >> 6)];
+				*r++ = digit[s[2] & 0x3F];
+			}
+			if (n) {
+				*r++ = digit[s[0] >> 2];
+				*r++ = digit[((s[0] & 3) << 4) | (n == 2 ? s[1] >> 4 : 0)];
+				*r++ = n == 2 ? digit[(s[1] & 0xF) << 2] : '=';
+				*r++ = '=';
+			}
+			*r++ = '"';
+			p = r;
+		}
+#endif
+	};
+
+	inline std::string to_string(const json::value& v, bool pretty = false)
+	{
+		writer w(pretty);
+
+		return w.value(v).str();
+	}
+	inline std::string to_string(const json::object& o, bool pretty = false)
+	{
+		writer w(pretty);
+
+		return w.value(o).str();
+	}
+
+	//
+	// paths
+	//
+
+	// A path compiled once into steps and evaluated against any number of
+	// trees without allocating. Either an RFC 6901 JSON Pointer, "/a/b/3/c"
+	// with ~1 for '/' and ~0 for '~', or a dotted path, "a.b[3].c", with an
+	// optional leading $, ['quoted'] keys and * or [*] for every member or
+	// element. Steps of digits index arrays and name members of objects.
+	// An invalid path matches nothing.
+	class path {
+	public:
+		path()
+			: valid_(true)
+		{ }
+		explicit path(const char* p)
+		{
+			compile(p, strlen(p));
+		}
+		explicit path(const std::string& p)
+		{
+			compile(p.data(), p.size());
+		}
+
+		bool valid() const
+		{
+			return valid_;
+		}
+		size_t size() const
+		{
+			return steps.size();
+		}
+
+		// the first match or null, the empty path matches v itself but
+		// an object has no value to return
+		const json::value* find(const json::value& v) const
+		{
+			const json::value* r = 0;
+
+			each(v, [&r](const json::value& u) { r = &u; return false; });
+
+			return r;
+		}
+		const json::value* find(const json::object& o) const
+		{
+			const json::value* r = 0;
+
+			each(o, [&r](const json::value& u) { r = &u; return false; });
+
+			return r;
+		}
+		json::value* find(json::value& v) const
+		{
+			return const_cast<json::value*>(find(static_cast<const json::value&>(v)));
+		}
+		json::value* find(json::object& o) const
+		{
+			return const_cast<json::value*>(find(static_cast<const json::object&>(o)));
+		}
+
+		// f(const json::value&) for each match, in the order containers
+		// iterate, while it returns true, and the number of calls
+		template<class F>
+		size_t each(const json::value& v, F f) const
+		{
+			size_t n = 0;
+
+			if (valid_)
+				visit(v, 0, f, n);
+
+			return n;
+		}
+		template<class F>
+		size_t each(const json::object& o, F f) const
+		{
+			size_t n = 0;
+
+			if (valid_ && !steps.empty())
+				visit(o, 0, f, n);
+
+			return n;
+		}
+
+	private:
+		struct step {
+			std::string key;
+			size_t index; // npos unless key is an array index
+			bool any;     // wildcard
+		};
+		std::vector<step> steps;
+		bool valid_;
+
+		template<class F>
+		bool visit(const json::value& v, size_t i, F& f, size_t& n) const
+		{
+			if (i == steps.size()) {
+				++n;
+
+				return f(v);
+			}
+			if (v.type == JSON_OBJECT)
+				return visit(*v.data.object, i, f, n);
+			if (v.type != JSON_ARRAY)
+				return true;
+
+			const step& s = steps[i];
+			if (s.any) {
+				for (size_t j = 0; j < v.data.array.size; ++j)
+					if (!visit(v[j], i + 1, f, n))
+						return false;
+
+				return true;
+			}
+
+			return s.index >= v.data.array.size || visit(v[s.index], i + 1, f, n);
+		}
+		template<class F>
+		bool visit(const json::object& o, size_t i, F& f, size_t& n) const
+		{
+			const step& s = steps[i];
+
+			if (s.any) {
+				for (json::object::const_iterator j = o.begin(); j != o.end(); ++j)
+					if (!visit(j->second, i + 1, f, n))
+						return false;
+
+				return true;
+			}
+
+			json::object::const_iterator j = o.find(s.key);
+
+			return j == o.end() || visit(j->second, i + 1, f, n);
+		}
+
+		// digits without a leading zero, like a pointer's array index
+		static size_t index(const std::string& k)
+		{
+			if (k.empty() || k.size() > 18 || (k[0] == '0' && k.size() > 1))
+				return std::string::npos;
+
+			size_t i = 0;
+			for (size_t j = 0; j < k.size(); ++j) {
+				if (!isdigit(static_cast<unsigned char>(k[j])))
+					return std::string::npos;
+				i = 10*i + (k[j] - '0');
+			}
+
+			return i;
+		}
+		static step key(const std::string& k, bool any = false)
+		{
+			step s;
+
+			s.key = k;
+			s.index = any ? std::string::npos : index(k);
+			s.any = any;
+
+			return s;
+		}
+		void compile(const char* p, size_t n)
+		{
+			valid_ = n == 0 || *p == '/' ? pointer(p, p + n) : dotted(p, p + n);
+			if (!valid_)
+				steps.clear();
+		}
+		bool pointer(const char* p, const char* e)
+		{
+			while (p != e) {
+				std::string k;
+				for (++p; p != e && *p != '/'; ++p) {
+					if (*p != '~') {
+						k += *p;
+						continue;
+					}
+					if (++p == e || (*p != '0' && *p != '1'))
+						return false;
+					k += *p == '0' ? '~' : '/';
+				}
+				steps.push_back(key(k));
+			}
 
 			return true;
 		}
-		inline object read_members(std::istream& is)
+		bool dotted(const char* p, const char* e)
 		{
-			object o;
-			std::pair<std::string,json::value> kv;
+			if (p != e && *p == '$')
+				++p;
+			for (bool first = true; p != e; first = false) {
+				if (*p == '[') {
+					if (++p == e)
+						return false;
+					if (*p == '*') {
+						steps.push_back(key("*", true));
+						++p;
+					}
+					else if (*p == '\'' || *p == '\"') {
+						char q = *p;
+						const char* b = ++p;
+						while (p != e && *p != q)
+							++p;
+						if (p == e)
+							return false;
+						steps.push_back(key(std::string(b, p)));
+						++p;
+					}
+					else {
+						const char* b = p;
+						while (p != e && *p != ']')
+							++p;
+						steps.push_back(key(std::string(b, p)));
+						if (steps.back().index == std::string::npos)
+							return false;
+					}
+					if (p == e || *p != ']')
+						return false;
+					++p;
+				}
+				else {
+					if (*p == '.')
+						++p;
+					else if (!first)
+						return false;
+					const char* b = p;
+					while (p != e && *p != '.' && *p != '[')
+						++p;
+					if (p == b)
+						return false;
+					std::string k(b, p);
+					steps.push_back(key(k, k == "*"));
+				}
+			}
+
+			return true;
+		}
+	};
+
+	//
+	// structs
+	//
+
+	// JSON_FIELDS(a, b, c) in a struct lists the members, up to 16, that
+	// are written and read by name. It gives the struct a static
+	// json_fields_(s, v) calling v(name, s.member) for each in turn until
+	// one returns false. Names are literals, so matching a key costs a
+	// length compare and a fixed size memcmp per member.
+	// Members may be bool, int32_t, int64_t, double, std::string, other
+	// such structs and vectors of these.
+#define JSON_FIELDS(...) \
+	template<class S_, class V_> \
+	static bool json_fields_(S_& s_, V_& v_) \
+	{ \
+		return JSON_EACH_(JSON_FIELD_, __VA_ARGS__) true; \
+	}
+#define JSON_FIELD_(m) v_(#m, s_.m) &&
+#define JSON_EXPAND_(x) x
+#define JSON_CAT_(a, b) a##b
+#define JSON_COUNT_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, n, ...) n
+#define JSON_EACH_N_(n, f, ...) JSON_EXPAND_(JSON_CAT_(JSON_EACH_, n)(f, __VA_ARGS__))
+#define JSON_EACH_(f, ...) JSON_EACH_N_(JSON_EXPAND_(JSON_COUNT_(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1)), f, __VA_ARGS__)
+#define JSON_EACH_1(f, a) f(a)
+#define JSON_EACH_2(f, a, ...) f(a) JSON_EXPAND_(JSON_EACH_1(f, __VA_ARGS__))
+#define JSON_EACH_3(f, a, ...) f(a) JSON_EXPAND_(JSON_EACH_2(f, __VA_ARGS__))
+#define JSON_EACH_4(f, a, ...) f(a) JSON_EXPAND_(JSON_EACH_3(f, __VA_ARGS__))
+#define JSON_EACH_5(f, a, ...) f(a) JSON_EXPAND_(JSON_EACH_4(f, __VA_ARGS__))
+#define JSON_EACH_6(f, a, ...) f(a) JSON_EXPAND_(JSON_EACH_5(f, __VA_ARGS__))
+#define JSON_EACH_7(f, a, ...) f(a) JSON_EXPAND_(JSON_EACH_6(f, __VA_ARGS__))
+#define JSON_EACH_8(f, a, ...) f(a) JSON_EXPAND_(JSON_EACH_7(f, __VA_ARGS__))
+#define JSON_EACH_9(f, a, ...) f(a) JSON_EXPAND_(JSON_EACH_8(f, __VA_ARGS__))
+#define JSON_EACH_10(f, a, ...) f(a) JSON_EXPAND_(JSON_EACH_9(f, __VA_ARGS__))
+#define JSON_EACH_11(f, a, ...) f(a) JSON_EXPAND_(JSON_EACH_10(f, __VA_ARGS__))
+#define JSON_EACH_12(f, a, ...) f(a) JSON_EXPAND_(JSON_EACH_11(f, __VA_ARGS__))
+#define JSON_EACH_13(f, a, ...) f(a) JSON_EXPAND_(JSON_EACH_12(f, __VA_ARGS__))
+#define JSON_EACH_14(f, a, ...) f(a) JSON_EXPAND_(JSON_EACH_13(f, __VA_ARGS__))
+#define JSON_EACH_15(f, a, ...) f(a) JSON_EXPAND_(JSON_EACH_14(f, __VA_ARGS__))
+#define JSON_EACH_16(f, a, ...) f(a) JSON_EXPAND_(JSON_EACH_15(f, __VA_ARGS__))
+
+	inline void write(writer& w, bool b) { w.boolean(b); }
+	inline void write(writer& w, int32_t i) { w.integer(i); }
+	inline void write(writer& w, int64_t i) { w.integer(i); }
+	inline void write(writer& w, double d) { w.number(d); }
+	inline void write(writer& w, const std::string& s) { w.string(string_(s.size(), s.data())); }
+	template<class T> void write(writer& w, const std::vector<T>& v);
+	template<class T> void write(writer& w, const T& s);
+
+	struct field_writer {
+		writer& w;
+
+		template<class T, size_t N>
+		bool operator()(const char (&name)[N], const T& m)
+		{
+			w.key(string_(N - 1, name));
+			write(w, m);
+
+			return true;
+		}
+	};
+
+	template<class T>
+	void write(writer& w, const std::vector<T>& v)
+	{
+		w.begin_array();
+		for (size_t i = 0; i < v.size(); ++i)
+			write(w, v[i]);
+		w.end_array();
+	}
+	template<class T>
+	void write(writer& w, const T& s)
+	{
+		field_writer f = { w };
+
+		w.begin_object();
+		T::json_fields_(s, f);
+		w.end_object();
+	}
+	template<class T>
+	std::string to_json(const T& s, bool pretty = false)
+	{
+		writer w(pretty);
+
+		write(w, s);
+
+		return w.str();
+	}
+
+	// false if the text does not have the types of the members, members
+	// that are missing are left as they are and unknown keys skipped
+	inline bool read(parse::reader& r, bool& b) { return r.boolean(b); }
+	inline bool read(parse::reader& r, int64_t& i)
+	{
+		json::element x;
+
+		if (!r.number(x))
+			return false;
+		i = x.data.int64;
+
+		return x.type == JSON_INT64;
+	}
+	inline bool read(parse::reader& r, int32_t& i)
+	{
+		int64_t l;
+
+		if (!read(r, l) || l < INT32_MIN || l > INT32_MAX)
+			return false;
+		i = static_cast<int32_t>(l);
+
+		return true;
+	}
+	inline bool read(parse::reader& r, double& d)
+	{
+		json::element x;
+
+		if (!r.number(x))
+			return false;
+		d = x.type == JSON_INT64 ? static_cast<double>(x.data.int64) : x.data.number;
+
+		return true;
+	}
+	inline bool read(parse::reader& r, std::string& s) { return r.string(s); }
+	template<class T> bool read(parse::reader& r, std::vector<T>& v);
+	template<class T> bool read(parse::reader& r, T& s);
+
+	struct field_reader {
+		parse::reader& r;
+		const json::string& key;
+		bool found;
+		bool ok;
+
+		template<class T, size_t N>
+		bool operator()(const char (&name)[N], T& m)
+		{
+			if (key.size != N - 1 || memcmp(key.data, name, N - 1))
+				return true;
+			found = true;
+			ok = read(r, m);
+
+			return false;
+		}
+	};
+
+	template<class T>
+	bool read(parse::reader& r, std::vector<T>& v)
+	{
+		bool first = true;
+
+		if (!r.begin_array())
+			return false;
+		v.clear();
+		while (r.more(']', first)) {
+			v.push_back(T());
+			if (!read(r, v.back()))
+				return false;
+		}
+
+		return !r.error();
+	}
+	template<class T>
+	bool read(parse::reader& r, T& s)
+	{
+		bool first = true;
+		json::string k;
+
+		if (!r.begin_object())
+			return false;
+		while (r.more('}', first)) {
+			if (!r.key(k))
+				return false;
+			field_reader f = { r, k, false, false };
+			T::json_fields_(s, f);
+			if (f.found ? !f.ok : !r.skip())
+				return false;
+		}
+
+		return !r.error();
+	}
+	template<class T>
+	bool from_json(const char* buf, size_t len, T& s)
+	{
+		parse::reader r(buf, len);
+
+		return read(r, s) && r.done();
+	}
+
+	//
+	// newline delimited
+	//
 
-			while (read_pair(is, kv)) {
-				o.insert(kv);
+	// Parses a buffer holding one JSON document per line on a pool of
+	// threads. The buffer is cut into chunks at newlines and each chunk
+	// is parsed by one thread into an arena of its own, which is reused
+	// once the chunk has been delivered.
+	// Documents are given to f(const json::value& doc, size_t offset),
+	// with the offset of the line in the buffer. Ordered, f is called on
+	// the calling thread in input order while the pool parses ahead.
+	// Unordered, f is called from the pool threads as soon as each chunk
+	// is parsed, concurrently, so it must be thread safe. Either way, if
+	// f throws the pool is stopped and joined and the exception rethrown.
+	// Blank lines are skipped and a line that is not exactly one JSON
+	// value, give or take space, is given as an undefined value.
+	class ndjson {
+	public:
+		// threads 0 uses every core
+		explicit ndjson(unsigned threads = 0, size_t chunk = 1 << 20)
+			: threads(threads ? threads : std::max(1u, std::thread::hardware_concurrency())), chunk(chunk ? chunk : 1)
+		{ }
+
+		// the number of lines delivered
+		template<class F>
+		size_t read(const char* buf, size_t len, F f, bool ordered = true)
+		{
+			std::vector<const char*> cut = split(buf, len);
+			size_t chunks = cut.size() - 1;
+			std::atomic<size_t> next(0), lines(0);
+
+			if (!ordered) {
+				// the calling thread is one of the pool, the first exception
+				// from f stops the others taking chunks and is rethrown
+				std::exception_ptr error;
+				std::mutex m;
+				auto work = [&]() {
+					try {
+						json::arena a;
+						for (size_t i; (i = next++) < chunks; ) {
+							lines += each_line(cut[i], cut[i + 1], a, [&](json::value& v, const char* s) {
+								f(static_cast<const json::value&>(v), static_cast<size_t>(s - buf));
+							});
+							a.reset();
+						}
+					}
+					catch (...) {
+						std::lock_guard<std::mutex> l(m);
+						if (!error)
+							error = std::current_exception();
+						next = chunks;
+					}
+				};
+				std::vector<std::thread> pool;
+				for (unsigned t = 1; t < threads && t < chunks; ++t)
+					pool.push_back(std::thread(work));
+				work();
+				for (size_t t = 0; t < pool.size(); ++t)
+					pool[t].join();
+				if (error)
+					std::rethrow_exception(error);
+
+				return lines;
 			}
 
-			return o;
+			// chunk i is parsed into slot i % slots once the chunk
+			// slots before it has been delivered
+			struct slot {
+				json::arena a;
+				std::vector<json::value> docs;
+				std::vector<size_t> offsets;
+				bool done;
+			};
+			size_t slots = 2*static_cast<size_t>(threads);
+			std::vector<slot> slot_(slots);
+			size_t delivered = 0;
+			bool stop = false; // f threw
+			std::mutex m;
+			std::condition_variable parsed, freed;
+
+			auto work = [&]() {
+				for (size_t i; (i = next++) < chunks; ) {
+					slot& s = slot_[i % slots];
+					{
+						std::unique_lock<std::mutex> l(m);
+						freed.wait(l, [&]() { return stop || i < delivered + slots; });
+						if (stop)
+							return;
+					}
+					each_line(cut[i], cut[i + 1], s.a, [&](json::value& v, const char* p) {
+						s.docs.push_back(std::move(v));
+						s.offsets.push_back(p - buf);
+					});
+					std::lock_guard<std::mutex> l(m);
+					s.done = true;
+					parsed.notify_all();
+				}
+			};
+			for (size_t i = 0; i < slots; ++i)
+				slot_[i].done = false;
+			std::vector<std::thread> pool;
+			for (unsigned t = 0; t < threads && t < chunks; ++t)
+				pool.push_back(std::thread(work));
+
+			try {
+				for (size_t i = 0; i < chunks; ++i) {
+					slot& s = slot_[i % slots];
+					{
+						std::unique_lock<std::mutex> l(m);
+						parsed.wait(l, [&]() { return s.done; });
+					}
+					for (size_t j = 0; j < s.docs.size(); ++j)
+						f(static_cast<const json::value&>(s.docs[j]), s.offsets[j]);
+					lines += s.docs.size();
+					s.docs.clear();
+					s.offsets.clear();
+					s.a.reset();
+
+					std::lock_guard<std::mutex> l(m);
+					s.done = false;
+					++delivered;
+					freed.notify_all();
+				}
+			}
+			catch (...) {
+				{
+					std::lock_guard<std::mutex> l(m);
+					stop = true;
+					freed.notify_all();
+				}
+				for (size_t t = 0; t < pool.size(); ++t)
+					pool[t].join();
+				throw;
+			}
+			for (size_t t = 0; t < pool.size(); ++t)
+				pool[t].join();
+
+			return lines;
 		}
 
-		inline object read_object(std::istream& is)
+	private:
+		unsigned threads;
+		size_t chunk;
+
+		// chunk boundaries, each after a newline or at the end
+		std::vector<const char*> split(const char* buf, size_t len)
 		{
-			ensure (parse::eat('{', is));
-			object o = parse::read_members(is);
+			std::vector<const char*> cut(1, buf);
+			const char* e = buf + len;
 
-			return o;
+			for (const char* p = buf; e - p > static_cast<ptrdiff_t>(chunk); ) {
+				const char* nl = static_cast<const char*>(memchr(p + chunk, '\n', e - p - chunk));
+				if (!nl)
+					break;
+				p = nl + 1;
+				cut.push_back(p);
+			}
+			if (cut.back() != e)
+				cut.push_back(e);
+
+			return cut;
 		}
+		// g(value, line start) for each line that is not blank
+		template<class G>
+		static size_t each_line(const char* s, const char* e, json::arena& a, G g)
+		{
+			size_t n = 0;
 
-	} // namespace parse
+			while (s != e) {
+				const char* nl = static_cast<const char*>(memchr(s, '\n', e - s));
+				const char* end = nl ? nl : e;
+
+				if (parse::scan::skip_space(s, end) != end) {
+					parse::builder b(&a);
+					json::value v;
+					if (parse::read_one(b, s, end - s))
+						v = parse::take_value(b);
+					g(v, s);
+					++n;
+				}
+				s = nl ? nl + 1 : e;
+			}
+
+			return n;
+		}
+	};
 
 } // namespace bson
 
-std::ostream& operator<<(std::ostream& os, const json::value& v)
+inline std::ostream& operator<<(std::ostream& os, const json::value& v)
 {
-	switch (v.type) {
-	case JSON_STRING: os << '"' << v.data.string.data << '"'; break;
-	case JSON_NUMBER: os << v.data.number; break;
-	case JSON_OBJECT: os << '(' << v.data.object << ')'; break;
-	case JSON_ARRAY: { 
-		os << '[';
-		for (size_t i = 0; i < v.data.array.size; ++i) {
-			if (i) os << ',';
-			os << v[i];
-		}
-		os << ']';
-		break;
-	}
-	case JSON_TRUE:  os << "true"; break;
-	case JSON_FALSE: os << "false"; break;
-	case JSON_NULL:  os << "null"; break;
-	case JSON_BYTE: { for (size_t i = 0; i < v.data.byte.size; ++i) os << v.data.byte.data[i]; } break;
-	case JSON_INT32: os << v.data.int32; break;
-	case JSON_INT64: os << v.data.int64; break;
-	case JSON_DATE: os << v.data.date; break; // pretty print???
-
-	default:
-		os << "*undefined*";
-	}
-
-	return os;
+	json::writer w;
+
+	w.value(v);
+
+	return os.write(w.data(), w.size());
 }
-std::ostream& operator<<(std::ostream& os, const json::object& o)
+inline std::ostream& operator<<(std::ostream& os, const json::object& o)
 {
-	std::map<std::string,json::value>::const_iterator i;
+	json::writer w;
 
-	os << '{';
-	for (i = o.begin(); i != o.end(); ++i) {
-		if (i != o.begin()) os << ',';
-		os << '"' << i->first << "\":" << i->second; 
-	}
-	os << '}';
+	w.value(o);
 
-	return os;
+	return os.write(w.data(), w.size());
 }
 
-std::istream& operator>>(std::istream& is, json::value& v)
+inline std::istream& operator>>(std::istream& is, json::value& v)
 {
 	v = json::parse::read_value(is);
 
 	return is;
 }
-std::istream& operator>>(std::istream& is, json::object& o)
+inline std::istream& operator>>(std::istream& is, json::object& o)
 {
 	o = json::parse::read_object(is);
 
@@ -0,0 +1,86 @@
+// mapped_file.h - read only view of a whole file
+#pragma once
+#include <cstddef>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace json {
+
+	// Whole file mapped read only, empty if it could not be opened.
+	// The pages are read in as they are touched, so a file larger than
+	// memory can still be scanned once.
+	class mapped_file {
+		mapped_file(const mapped_file&);
+		mapped_file& operator=(const mapped_file&);
+	public:
+		explicit mapped_file(const char* path)
+			: p(0), n(0), ok(false)
+		{
+#ifdef _WIN32
+			HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+			LARGE_INTEGER size;
+			if (f == INVALID_HANDLE_VALUE)
+				return;
+			if (GetFileSizeEx(f, &size)) {
+				n = static_cast<size_t>(size.QuadPart);
+				HANDLE m = n ? CreateFileMappingA(f, 0, PAGE_READONLY, 0, 0, 0) : 0;
+				if (m) {
+					p = static_cast<const char*>(MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0));
+					CloseHandle(m);
+				}
+				ok = p || !n;
+			}
+			CloseHandle(f);
+#else
+			int f = open(path, O_RDONLY);
+			struct stat st;
+			if (f < 0)
+				return;
+			if (fstat(f, &st) == 0) {
+				n = static_cast<size_t>(st.st_size);
+				if (n) {
+					void* m = mmap(0, n, PROT_READ, MAP_PRIVATE, f, 0);
+					if (m != MAP_FAILED) {
+						madvise(m, n, MADV_SEQUENTIAL);
+						p = static_cast<const char*>(m);
+					}
+				}
+				ok = p || !n;
+			}
+			::close(f);
+#endif
+			if (!ok)
+				n = 0;
+		}
+		~mapped_file()
+		{
+			if (!p)
+				return;
+#ifdef _WIN32
+			UnmapViewOfFile(p);
+#else
+			munmap(const_cast<char*>(p), n);
+#endif
+		}
+
+		// false if the file could not be opened or mapped
+		bool valid() const { return ok; }
+		const char* data() const { return p; }
+		size_t size() const { return n; }
+
+	private:
+		const char* p;
+		size_t n;
+		bool ok;
+	};
+
+} // namespace json
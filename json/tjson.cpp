@@ -0,0 +1,810 @@
+// tjson.cpp - test json
+#include <cassert>
+#include <sstream>
+#include <stdexcept>
+#include "json.h"
+#include "mapped_file.h"
+
+using json::string_;
+
+// structs read and written without a tree
+struct point {
+	int32_t x;
+	double y;
+	JSON_FIELDS(x, y)
+};
+struct shape {
+	std::string name;
+	bool closed;
+	int64_t id;
+	std::vector<point> points;
+	std::vector<std::string> tags;
+	JSON_FIELDS(name, closed, id, points, tags)
+};
+
+// documents the istream parser also understands
+const char* docs[] = {
+	"{\"a\":[1,2.5,\"x\",[true,false]]}",
+	"{ \"number\" : -1.25e3 }",
+	"{\"array\":[\"hello\",\"world\",[1,[2,[3]]]]}",
+	"{\"a\":[1],\"b\":\"two\"}",
+	"{\"o\":{\"k\":\"with spaces, \\\"quotes\\\" and \\u00e9\"},\"n\":[{}, {\"x\":false}]}",
+	"{\"a\":[]}",
+	"{\"a\":[1,[],2],\"b\":[[],[[]]],\"c\":{}}",
+};
+
+void test_parse_buffer(void)
+{
+	for (size_t i = 0; i < sizeof(docs)/sizeof(*docs); ++i) {
+		json::object o, p;
+		std::istringstream is(docs[i]);
+
+		is >> o;
+		p = json::parse::read_object(docs[i], strlen(docs[i]));
+		assert (is && o == p && json::to_string(o) == json::to_string(p));
+	}
+
+	// the istream parser reads one value and leaves the rest in the stream
+	{
+		json::value u, w;
+		std::istringstream is("[1] [2]");
+		is >> u >> w;
+		assert (is && u.data.array.size == 1 && w.data.array.size == 1 && w[0] == 2.);
+		is >> u;
+		assert (!is && !u);
+
+		// cut short or malformed is an error
+		const char* cut[] = { "{\"a\":1", "{\"a\":[1,2", "{\"a\":tru}", "{\"a\" 1}" };
+		for (size_t i = 0; i < sizeof(cut)/sizeof(*cut); ++i) {
+			json::object o;
+			std::istringstream js(cut[i]);
+			js >> o;
+			assert (!js && o.empty());
+		}
+	}
+
+	// a buffer holds exactly one value
+	const char* trailing[] = { "1x", "[1] [2]", "{}x", "{\"a\":1} {\"b\":2}" };
+	for (size_t i = 0; i < sizeof(trailing)/sizeof(*trailing); ++i) {
+		json::parse::builder b;
+		assert (!json::parse::read_one(b, trailing[i], strlen(trailing[i])) && !b.value());
+	}
+	{
+		json::parse::builder b;
+		assert (json::parse::read_one(b, " [1] \r\n", 7) && b.value().data.array.size == 1);
+	}
+
+	const char doc[] = "{\"s\":\"a\\\"b\\\\c\\u00e9\\ud83d\\ude00\",\n\t\"o\":{\"x\":1,\"y\":[]},\"t\":true,\"n\":null}";
+	json::object o = json::parse::read_object(doc, sizeof(doc) - 1);
+	assert (o.size() == 4);
+	assert (o["s"] == "a\"b\\c\xc3\xa9\xf0\x9f\x98\x80");
+	assert (o["o"].type == JSON_OBJECT);
+	assert ((*o["o"].data.object)["x"] == 1.);
+	assert ((*o["o"].data.object)["y"].type == JSON_ARRAY);
+	assert ((*o["o"].data.object)["y"].data.array.size == 0);
+	assert (o["t"] == true);
+	assert (o["n"].type == JSON_NULL);
+
+	// buffer need not be null terminated
+	const char num[] = "[1,2]x";
+	json::value v = json::parse::read_value(num, 5);
+	assert (v.type == JSON_ARRAY && v.data.array.size == 2);
+	assert (v[1] == 2.);
+}
+
+void test_parse_long(void)
+{
+	// exercise the block scanners across 16 and 32 byte boundaries
+	std::string s = "[";
+	for (size_t i = 0; i < 100; ++i) {
+		s += std::string(i % 37, ' ');
+		s += '"';
+		s += std::string(i, 'a');
+		if (i % 3 == 0)
+			s += "\\n";
+		s += '"';
+		s += i + 1 < 100 ? "," : "]";
+	}
+
+	json::value v = json::parse::read_value(s.data(), s.size());
+	assert (v.type == JSON_ARRAY && v.data.array.size == 100);
+	for (size_t i = 0; i < 100; ++i) {
+		std::string t(i, 'a');
+		if (i % 3 == 0)
+			t += '\n';
+		assert (v[i] == t.c_str());
+	}
+}
+
+void test_arena(void)
+{
+	const char doc[] = "{\"a\":[1,\"two\",[3,{\"b\":\"four\"}]],\"c\":\"five\"}";
+	json::object h = json::parse::read_object(doc, sizeof(doc) - 1);
+	json::object o;
+	{
+		json::arena a(16); // force several blocks
+		json::object& p = json::parse::read_object(doc, sizeof(doc) - 1, a);
+		assert (p == h);
+		assert (p["a"].flags & JSON_BORROWED);
+		assert (p["c"] == "five");
+
+		// copies out of an arena are owned
+		o = p;
+		assert (!(o["a"].flags & JSON_BORROWED));
+
+		a.reset();
+		json::value v = json::parse::read_value(doc, sizeof(doc) - 1, a);
+		assert (v.type == JSON_OBJECT && *v.data.object == h);
+
+		json::value s("hello", a), t(v, a);
+		assert (s == "hello" && (s.flags & JSON_BORROWED));
+		assert (t == v);
+	}
+	assert (o == h);
+}
+
+void test_push_back(void)
+{
+	json::value v;
+
+	v.reserve(10);
+	assert (v.type == JSON_ARRAY && v.data.array.size == 0 && v.capacity() == 10);
+	for (int i = 0; i < 1000; ++i)
+		v.push_back(json::value(static_cast<double>(i)));
+	assert (v.data.array.size == 1000 && v.capacity() >= 1000);
+	for (int i = 0; i < 1000; ++i)
+		assert (v[i] == static_cast<double>(i));
+
+	json::value w(2);
+	w[0] = "a";
+	w[1] = "b";
+	v.push_back(w.data.array);
+	assert (v.data.array.size == 1002 && v[1001] == "b");
+
+	json::value u(v);
+	assert (u == v);
+}
+
+void test_flat_map(void)
+{
+	json::flat_map<std::string, json::value> m;
+
+	m["b"] = 2.;
+	m["c"] = 3.;
+	assert (m.insert(json::pair("a", json::value(1.))).second);
+	assert (!m.insert(json::pair("a", json::value(4.))).second);
+	assert (m.size() == 3 && m.begin()->first == "b" && m["a"] == 1.);
+	assert (m.find("d") == m.end() && m.count("c") == 1);
+	assert (m.erase("b") == 1 && m.size() == 2 && m.find("b") == m.end());
+
+	m.append("z") = "last";
+	m.append("a") = "duplicate";
+	m.reindex();
+	assert (m.size() == 3 && m["a"] == 1. && m["z"] == "last");
+
+	// in hash mode too, many duplicates in one pass
+	json::flat_map<std::string, json::value> h;
+	for (int i = 0; i < 20; ++i)
+		h.append("k" + std::to_string(i)) = json::value(double(i));
+	for (int i = 0; i < 1000; ++i)
+		h.append(i % 2 ? "k0" : "k19") = "duplicate";
+	h.append("last") = "new";
+	h.reindex();
+	assert (h.size() == 21 && h["k0"] == 0. && h["k19"] == 19. && h["last"] == "new");
+	assert ((h.end() - 1)->first == "last" && h.find("k7")->second == 7.);
+
+	std::string big = "{";
+	for (int i = 0; i < 20; ++i)
+		big += "\"k" + std::to_string(i) + "\":" + std::to_string(i) + ",";
+	for (int i = 0; i < 100000; ++i)
+		big += "\"k0\":-1,";
+	big += "\"end\":true}";
+	json::object b = json::parse::read_object(big.data(), big.size());
+	assert (b.size() == 21 && b["k0"] == 0. && b["end"] == true);
+
+	// first key wins for either object type
+	const char doc[] = "{\"k\":1,\"j\":\"x\",\"k\":2}";
+	json::object o = json::parse::read_object(doc, sizeof(doc) - 1);
+	assert (o.size() == 2 && o["k"] == 1.);
+}
+
+void test_view(void)
+{
+	const char doc[] = "{\"plain\":\"abc\",\"esc\":\"a\\\"b\\u00e9\",\"list\":[\"x\",\"y\\n\"]}";
+	json::object h = json::parse::read_object(doc, sizeof(doc) - 1);
+	json::object o = json::parse::view_object(doc, sizeof(doc) - 1);
+
+	json::value& plain = o["plain"];
+	assert (plain.flags == JSON_BORROWED);
+	assert (plain.data.string.data > doc && plain.data.string.data < doc + sizeof(doc));
+	assert (plain == "abc");
+
+	json::value& esc = o["esc"];
+	assert (esc.flags == (JSON_BORROWED|JSON_ESCAPED));
+	assert (esc.data.string.size == 10); // a\"b\u00e9
+	assert (esc == "a\"b\xc3\xa9");
+	assert (o == h);
+
+	// copies are decoded and owned
+	json::value copy(esc);
+	assert (copy.flags == JSON_INLINE && copy.str().size == 5);
+
+	esc.unescape();
+	assert (!(esc.flags & (JSON_BORROWED|JSON_ESCAPED)) && esc == copy);
+	assert (json::unescape(o["list"][1].data.string) == "y\n");
+
+	json::arena a;
+	json::object& p = json::parse::view_object(doc, sizeof(doc) - 1, a);
+	assert (p == h);
+	p["esc"].unescape(a);
+	assert ((p["esc"].flags & ~JSON_INLINE) == JSON_BORROWED && p == h);
+}
+
+// counts events
+struct counter : json::parse::handler {
+	int objects, arrays, keys, strings, numbers, literals;
+	double sum;
+
+	counter() : objects(0), arrays(0), keys(0), strings(0), numbers(0), literals(0), sum(0) { }
+	bool start_object() { ++objects; return true; }
+	bool start_array() { ++arrays; return true; }
+	bool key(const json::string&) { ++keys; return true; }
+	bool string(const json::string&, unsigned char) { ++strings; return true; }
+	bool number(double d) { ++numbers; sum += d; return true; }
+	bool boolean(bool) { ++literals; return true; }
+	bool null() { ++literals; return true; }
+};
+
+void test_stream(void)
+{
+	const char doc[] = "{\"a\": [1, 2.5, -3e2], \"b\\u00e9\": {\"c\": \"x\\\"y\", \"d\": [true, false]}, \"e\": [[], {}], \"f\": 42}";
+	const size_t len = sizeof(doc) - 1;
+	json::object whole = json::parse::read_object(doc, len);
+	assert (whole.size() == 4 && (*whole["b\xc3\xa9"].data.object)["c"] == "x\"y");
+
+	// every split point, tokens carried over between chunks
+	for (size_t i = 0; i <= len; ++i) {
+		json::parse::builder b;
+		json::parse::stream<json::parse::builder> p(b);
+		bool more = p.feed(doc, i) && p.feed(doc + i, len - i) && p.finish();
+		assert (!more && b.complete() && *b.value().data.object == whole);
+	}
+	// one byte at a time
+	{
+		json::parse::builder b;
+		json::parse::stream<json::parse::builder> p(b);
+		for (size_t i = 0; i < len && p.feed(doc + i, 1); ++i)
+			;
+		assert (b.complete() && *b.value().data.object == whole);
+	}
+
+	// a sequence of top level values, the last number ends with the input
+	const char seq[] = "{\"k\":[null,\"s\"]}\n[1,2]\n3";
+	counter c;
+	json::parse::stream<counter> p(c);
+	assert (p.feed(seq, 10) && p.feed(seq + 10, sizeof(seq) - 11));
+	assert (c.numbers == 2);
+	assert (p.finish() && !p.error());
+	assert (c.objects == 1 && c.arrays == 2 && c.keys == 1 && c.strings == 1);
+	assert (c.numbers == 3 && c.sum == 6 && c.literals == 1);
+
+	// depth is not bounded by the call stack
+	std::string deep(100000, '[');
+	deep.append(100000, ']');
+	json::arena a;
+	json::value v = json::parse::read_value(deep.data(), deep.size(), a);
+	assert (v.type == JSON_ARRAY && v.data.array.size == 1);
+}
+
+void test_number(void)
+{
+	const char doc[] = "[0, -7, 9223372036854775807, -9223372036854775808, 9223372036854775808, 1.5, -0.0, 1e2, 0.1, 2.2250738585072014e-308]";
+	json::value v = json::parse::read_value(doc, sizeof(doc) - 1);
+	assert (v.type == JSON_ARRAY && v.data.array.size == 10);
+	assert (v[1].type == JSON_INT64 && v[1].data.int64 == -7);
+	assert (v[2].type == JSON_INT64 && v[2].data.int64 == INT64_MAX);
+	assert (v[3].type == JSON_INT64 && v[3].data.int64 == INT64_MIN);
+	assert (v[4].type == JSON_NUMBER && v[4] == 9223372036854775808.);
+	assert (v[6].type == JSON_NUMBER && v[6] == 0.);
+	assert (v[7].type == JSON_NUMBER && v[7] == 100.);
+	assert (v[9] == 2.2250738585072014e-308);
+
+	// shortest text that reads back the same, whole doubles stay doubles
+	std::ostringstream os;
+	os << v;
+	assert (os.str() == "[0,-7,9223372036854775807,-9223372036854775808,9223372036854776000.0,1.5,-0.0,100.0,0.1,2.2250738585072014e-308]");
+	json::value w = json::parse::read_value(os.str().data(), os.str().size());
+	for (size_t i = 0; i < 10; ++i)
+		assert (w[i].type == v[i].type && 0 == memcmp(&w[i].data, &v[i].data, 8));
+
+	char buf[32];
+	const double d[] = { 1/3., 5e-324, 1.7976931348623157e308, 123456.789, 1e20, 1e21, 1e-7 };
+	const char* text[] = { "0.3333333333333333", "5e-324", "1.7976931348623157e308", "123456.789", "100000000000000000000.0", "1e21", "1e-7" };
+	for (size_t i = 0; i < sizeof(d)/sizeof(*d); ++i) {
+		size_t n = json::write_number(d[i], buf);
+		assert (std::string(buf, n) == text[i]);
+	}
+
+	// the istream parser agrees
+	std::istringstream is(doc);
+	json::value u;
+	is >> u;
+	assert (u.data.array.size == 10 && u[3].type == JSON_INT64 && u[9] == v[9]);
+
+	json::element e;
+	const char* bad[] = { "01", "1.", ".5", "-", "1e", "+1", "0x10", "1e+" };
+	for (size_t i = 0; i < sizeof(bad)/sizeof(*bad); ++i)
+		assert (!json::read_number(bad[i], strlen(bad[i]), e));
+}
+
+void test_writer(void)
+{
+	// escaping, the scan is vectorised so the string is longer than a register
+	const char doc[] = "{\"k\\\"ey\": \"a quote \\\" and a backslash \\\\ then \\n\\t\\u0001 and more text after it\", \"n\": [1, 2.5, true, null, {}], \"e\": []}";
+	json::object o = json::parse::read_object(doc, sizeof(doc) - 1);
+	std::string s = json::to_string(o);
+	assert (s.find("\"a quote \\\" and a backslash \\\\ then \\n\\t\\u0001 and more text after it\"") != std::string::npos);
+	assert (s.find("\"k\\\"ey\":") != std::string::npos);
+	json::object r = json::parse::read_object(s.data(), s.size());
+	assert (json::to_string(r) == s);
+	std::ostringstream os;
+	os << o;
+	assert (os.str() == s);
+
+	// streaming, no tree needed
+	json::writer w;
+	w.begin_object().key("a").integer(1).key("b").begin_array().number(0.5).string("x\ty").boolean(false).null().end_array().key("c").begin_object().end_object().end_object();
+	assert (std::string(w.data(), w.size()) == "{\"a\":1,\"b\":[0.5,\"x\\ty\",false,null],\"c\":{}}");
+	w.clear();
+	w.begin_array().end_array();
+	assert (w.str() == "[]");
+
+	json::writer p(true);
+	p.begin_object().key("a").begin_array().integer(1).integer(2).end_array().key("b").begin_object().end_object().end_object();
+	assert (p.str() == "{\n  \"a\": [\n    1,\n    2\n  ],\n  \"b\": {}\n}");
+}
+
+void test_fields(void)
+{
+	shape s;
+	s.name = "tri\"angle";
+	s.closed = true;
+	s.id = INT64_MAX;
+	point p[] = { { 0, 0.5 }, { -3, 1e300 }, { INT32_MAX, -0.0 } };
+	s.points.assign(p, p + 3);
+	s.tags.push_back("a");
+
+	std::string text = json::to_json(s);
+	assert (text == "{\"name\":\"tri\\\"angle\",\"closed\":true,\"id\":9223372036854775807,\"points\":[{\"x\":0,\"y\":0.5},{\"x\":-3,\"y\":1e300},{\"x\":2147483647,\"y\":-0.0}],\"tags\":[\"a\"]}");
+
+	shape r;
+	assert (json::from_json(text.data(), text.size(), r));
+	assert (r.name == s.name && r.closed && r.id == s.id && r.tags == s.tags);
+	assert (r.points.size() == 3 && r.points[1].x == -3 && r.points[1].y == 1e300 && r.points[2].x == INT32_MAX);
+	assert (json::to_json(r, true) == json::to_json(s, true));
+
+	// unknown keys are skipped whatever they hold, missing members kept
+	const char doc[] = "{ \"extra\": {\"a\": [1, {\"b\": null}], \"c\": \"}\"}, \"id\": 7, \"more\": [[], {}], \"x\\u0079\": 1 }";
+	assert (json::from_json(doc, sizeof(doc) - 1, r));
+	assert (r.id == 7 && r.name == s.name);
+	point q = { 1, 2 };
+	const char esc[] = "{\"\\u0079\": 3}";
+	assert (json::from_json(esc, sizeof(esc) - 1, q) && q.x == 1 && q.y == 3);
+
+	// wrong types and bad text are errors
+	const char* bad[] = {
+		"{\"x\": 1.5}", "{\"x\": 2147483648}", "{\"y\": \"1\"}", "{\"x\": 1", "{\"x\": 1} x",
+		"[]", "{\"z\": [}", "{\"z\": {]}", "{\"x\" 1}", "{,\"x\": 1}",
+	};
+	for (size_t i = 0; i < sizeof(bad)/sizeof(*bad); ++i)
+		assert (!json::from_json(bad[i], strlen(bad[i]), q));
+}
+
+void test_inline(void)
+{
+	// up to 15 characters are held in the element
+	const char* s[] = { "", "ok", "fifteen chars..", "sixteen chars..." };
+	json::value v;
+	for (size_t i = 0; i < 4; ++i) {
+		json::value e(s[i]);
+		assert (e.flags == (i < 3 ? JSON_INLINE : JSON_OWNED));
+		assert (e.str().size == strlen(s[i]) && e.str().data[e.str().size] == 0 && e == s[i]);
+		v.push_back(e);
+	}
+	// moved bitwise as the array grows, copied with the bits
+	for (size_t i = 0; i < 100; ++i)
+		v.push_back(json::value("x"));
+	json::value w(v);
+	for (size_t i = 0; i < 4; ++i)
+		assert (v[i] == s[i] && w[i] == s[i]);
+
+	json::arena a;
+	json::value c(v[1], a);
+	assert (c == "ok" && c.str().data == c.data.chars);
+	c = w[3];
+	assert (c == s[3]);
+
+	const char doc[] = "[\"ok\",\"tag\\u0041\",\"a longer string than that\"]";
+	json::value p = json::parse::read_value(doc, sizeof(doc) - 1);
+	assert (p[0].flags == JSON_INLINE && p[1] == "tagA" && p[2].flags == JSON_OWNED);
+	assert (json::to_string(p) == "[\"ok\",\"tagA\",\"a longer string than that\"]");
+}
+
+void test_move(void)
+{
+	// payloads change hands without copying
+	json::value s("a string too long to be inline");
+	const char* p = s.str().data;
+	json::value t(std::move(s));
+	assert (s.type == JSON_UNDEFINED && t.str().data == p);
+
+	json::value a;
+	a.push_back(std::move(t));
+	assert (t.type == JSON_UNDEFINED && a[0].str().data == p);
+	a.emplace_back("x");
+	a.emplace_back(2.5);
+	json::value& e = a.emplace_back(json::object());
+	e.data.object->emplace("k", json::value(true));
+	assert (a.data.array.size == 4 && a[1] == "x" && a[2] == 2.5 && a[3].type == JSON_OBJECT);
+	assert ((*a[3].data.object)["k"] == true);
+
+	// a value that is not an array becomes the first element
+	json::value n(1.5);
+	n.emplace_back("y");
+	assert (n.type == JSON_ARRAY && n.data.array.size == 2 && n[0] == 1.5 && n[1] == "y");
+
+	// from a part of itself
+	a = std::move(a[0]);
+	assert (a.type == JSON_STRING && a.str().data == p);
+
+	json::object o;
+	o["k"] = std::move(a);
+	assert (o["k"].str().data == p);
+	json::value v(std::move(o));
+	assert (o.empty() && (*v.data.object)["k"].str().data == p);
+	assert (o.emplace("a", json::value(1.0)).second && !o.emplace("a", json::value(2.0)).second);
+	assert (o["a"] == 1.0);
+}
+
+void test_ndjson(void)
+{
+	// more lines than fit a chunk, with blank lines, crlf and bad lines
+	std::string buf;
+	std::vector<size_t> offsets;
+	for (size_t i = 0; i < 2000; ++i) {
+		if (i % 100 == 7)
+			buf += "  \n";
+		offsets.push_back(buf.size());
+		if (i == 1234)
+			buf += "{oops}\n";
+		else if (i == 1500)
+			buf += "{\"i\":1500} {\"two\":true}\n";
+		else
+			buf += "{\"i\":" + std::to_string(i) + ",\"s\":[\"some text\",null]}" + (i % 3 ? "\n" : "\r\n");
+	}
+	buf.erase(buf.size() - 1); // last line without a newline
+
+	for (unsigned t = 1; t <= 4; t *= 2) {
+		json::ndjson nd(t, 256);
+		size_t n = 0;
+		size_t lines = nd.read(buf.data(), buf.size(), [&](const json::value& v, size_t offset) {
+			assert (offset == offsets[n]);
+			if (n == 1234 || n == 1500)
+				assert (!v);
+			else
+				assert (v.type == JSON_OBJECT && (*v.data.object).find("i")->second == static_cast<double>(n));
+			++n;
+		});
+		assert (lines == 2000 && n == 2000);
+
+		// a throw from f stops the pool and reaches the caller
+		for (int ordered = 1; ordered >= 0; --ordered) {
+			std::atomic<size_t> calls(0);
+			bool thrown = false;
+			try {
+				nd.read(buf.data(), buf.size(), [&](const json::value&, size_t) {
+					if (++calls == 100)
+						throw std::runtime_error("stop");
+				}, ordered != 0);
+			}
+			catch (const std::runtime_error&) {
+				thrown = true;
+			}
+			assert (thrown && (ordered ? calls == 100 : calls >= 100 && calls < 2000));
+		}
+
+		// unordered, every line once
+		std::vector<std::atomic<int> > seen(2000);
+		std::mutex m;
+		lines = nd.read(buf.data(), buf.size(), [&](const json::value& v, size_t offset) {
+			size_t i = std::lower_bound(offsets.begin(), offsets.end(), offset) - offsets.begin();
+			assert (offsets[i] == offset && (i == 1234 || i == 1500 || v.type == JSON_OBJECT));
+			++seen[i];
+		}, false);
+		assert (lines == 2000);
+		for (size_t i = 0; i < 2000; ++i)
+			assert (seen[i] == 1);
+	}
+
+	// from a mapped file
+	const char* path = "tjson.ndjson";
+	FILE* f = fopen(path, "wb");
+	fwrite(buf.data(), 1, buf.size(), f);
+	fclose(f);
+	{
+		json::mapped_file mf(path);
+		assert (mf.valid() && mf.size() == buf.size() && 0 == memcmp(mf.data(), buf.data(), buf.size()));
+		size_t n = 0;
+		json::ndjson().read(mf.data(), mf.size(), [&](const json::value&, size_t) { ++n; });
+		assert (n == 2000);
+	}
+	remove(path);
+	assert (!json::mapped_file(path).valid());
+}
+
+json::value global;
+
+void test_alloc(void)
+{
+#ifndef JSON_NO_ALLOC_STATS
+	const char big[] = "a string too long to be inline";
+	{
+		json::alloc_scope s;
+		{
+			json::value v(big);
+			assert (s.stats().allocations == 1 && s.stats().live == int64_t(sizeof(big)));
+			json::value w(v);
+			assert (s.stats().allocations == 2 && s.stats().live == 2*int64_t(sizeof(big)));
+		}
+		json::alloc_stats a = s.stats();
+		assert (a.frees == 2 && a.live == 0 && a.peak == 2*int64_t(sizeof(big)));
+		assert (a.bytes == 2*sizeof(big));
+
+		// growing an array frees the old block and counts the new one
+		json::value v;
+		for (int i = 0; i < 100; ++i)
+			v.push_back(json::value(double(i)));
+		a = s.stats();
+		assert (a.allocations > 1 && a.allocations == a.frees + 1);
+		assert (a.live == int64_t(sizeof(size_t) + v.capacity()*sizeof(json::element)));
+	}
+
+	// nested scopes see only their own document
+	{
+		json::alloc_scope outer;
+		json::value keep(big);
+		{
+			json::alloc_scope inner;
+			const char doc[] = "{\"a\":[1,\"a string too long to be inline\"]}";
+			json::object o = json::parse::read_object(doc, sizeof(doc) - 1);
+			assert (inner.stats().allocations >= 2 && inner.stats().live > 0);
+		}
+		assert (outer.stats().live == int64_t(sizeof(big)));
+		assert (outer.stats().peak > outer.stats().live);
+	}
+
+	// map nodes are counted, one per member, besides the object the
+	// parser builds and frees once its members are swapped out
+#ifndef JSON_FLAT_OBJECT
+	{
+		const char doc[] = "{\"a\":1,\"b\":2,\"c\":3,\"d\":4}";
+		json::alloc_scope s;
+		{
+			json::object o = json::parse::read_object(doc, sizeof(doc) - 1);
+			assert (s.stats().allocations == 1 + 4 && s.stats().frees == 1);
+		}
+		assert (s.stats().frees == 1 + 4 && s.stats().live == 0);
+	}
+#endif
+
+	// arenas are not counted
+	{
+		json::alloc_scope s;
+		json::arena a;
+		json::value v(big, a);
+		assert (s.stats().allocations == 0);
+		// nor are the members of objects parsed into one
+		const char doc[] = "{\"a\":1,\"b\":{\"c\":[2]}}";
+		json::object& o = json::parse::read_object(doc, sizeof(doc) - 1, a);
+		assert (o.size() == 2 && o.get_allocator().resource() == &a);
+		assert (s.stats().allocations == 0);
+	}
+
+	// each thread counts its own, exited threads stay in the total
+	json::alloc_stats before = json::total_alloc_stats();
+	std::thread([&]() {
+		json::value v(big);
+		assert (json::thread_alloc_stats().allocations == 1);
+	}).join();
+	json::alloc_stats after = json::total_alloc_stats();
+	assert (after.allocations == before.allocations + 1 && after.live == before.live);
+
+	// values freed after their thread's counter is gone are still counted
+	std::thread([&]() {
+		static thread_local json::value t(big);
+		assert (t.type == JSON_STRING);
+	}).join();
+	after = json::total_alloc_stats();
+	assert (after.live == before.live && after.allocations - after.frees == before.allocations - before.frees);
+
+	// freed at exit, after the main thread's counter, see the test's FAIL_REGULAR_EXPRESSION
+	global = json::value("a string held until the statics are destroyed");
+#endif
+}
+
+// a memory that counts what it hands out
+struct pool : public json::memory {
+	size_t allocations;
+	size_t live;
+
+	pool() : allocations(0), live(0) { }
+	void* allocate(size_t n, size_t)
+	{
+		++allocations;
+		live += n;
+
+		return malloc(n);
+	}
+	void deallocate(void* p, size_t n, size_t)
+	{
+		live -= n;
+		free(p);
+	}
+};
+
+void test_memory(void)
+{
+	const char doc[] = "{\"a\":[1,\"a string too long to be inline\",{\"b\":\"another string, not inline\"}],\"c\":\"short\"}";
+	json::value h = json::parse::read_value(doc, sizeof(doc) - 1);
+	pool p;
+	{
+		json::alloc_scope s;
+		json::value v = json::parse::read_value(doc, sizeof(doc) - 1, p);
+		assert (v == h && (v.flags & JSON_MEMORY));
+		assert (p.allocations > 0);
+#ifndef JSON_NO_ALLOC_STATS
+		assert (s.stats().allocations == 0);
+#endif
+
+		// growing an array stays in its memory
+		json::value& a = (*v.data.object)["a"];
+		assert (a.flags & JSON_MEMORY);
+		for (int i = 0; i < 20; ++i)
+			a.push_back(json::value(double(i)));
+		assert (a.data.array.size == 23 && (a.flags & JSON_MEMORY) && a[1] == "a string too long to be inline");
+
+		// copies go to the heap
+		json::value c(v);
+		assert (c == v && !(c.flags & JSON_MEMORY));
+		assert (c.data.object->get_allocator().resource() == 0);
+
+		json::object o = json::parse::read_object(doc, sizeof(doc) - 1, p);
+		assert (o == *h.data.object && o.get_allocator().resource() == &p);
+		json::value d(h, p);
+		assert (d == h && (d.flags & JSON_MEMORY));
+		json::value b(size_t(3), reinterpret_cast<const uint8_t*>("xyz"), p);
+		assert (b.flags & JSON_MEMORY);
+	}
+	assert (p.live == 0);
+
+	// arena blocks from an upstream memory
+	{
+		json::arena a(p, 16);
+		json::object& o = json::parse::read_object(doc, sizeof(doc) - 1, a);
+		assert (o == *h.data.object && p.live > 0);
+	}
+	assert (p.live == 0);
+}
+
+void test_path(void)
+{
+	const char doc[] = "{\"a\":{\"b\":[10,20,30,{\"c\":\"deep\"}]},\"x/y\":1,\"m~n\":2,\"7\":\"seven\","
+		"\"list\":[{\"id\":1},{\"id\":2},{\"name\":\"none\"}]}";
+	json::value v = json::parse::read_value(doc, sizeof(doc) - 1);
+	const json::object& o = *v.data.object;
+
+	// pointers
+	assert (json::path("").find(v) == &v && !json::path("").find(o));
+	assert (*json::path("/a/b/3/c").find(v) == "deep");
+	assert (json::path("/a/b/3/c").find(o) == json::path("/a/b/3/c").find(v));
+	assert (*json::path("/a/b/0").find(o) == 10.0);
+	assert (*json::path("/x~1y").find(o) == 1.0 && *json::path("/m~0n").find(o) == 2.0);
+	assert (*json::path("/7").find(o) == "seven");
+	assert (!json::path("/a/b/4").find(o) && !json::path("/a/b/01").find(o) && !json::path("/a/b/-").find(o));
+	assert (!json::path("/nope/c").find(o) && !json::path("/a/b/0/c").find(o));
+	assert (!json::path("/a~2").valid() && !json::path("/a~2").find(o));
+
+	// dotted paths
+	json::path p("a.b[3].c");
+	assert (p.valid() && p.size() == 4 && *p.find(o) == "deep");
+	assert (*json::path("$.a.b[1]").find(o) == 20.0);
+	assert (*json::path("['x/y']").find(o) == 1.0 && *json::path("a[\"b\"][2]").find(o) == 30.0);
+	assert (!json::path("a..b").valid() && !json::path("a[x]").valid() && !json::path("a[1").valid());
+
+	// wildcards
+	std::vector<const json::value*> ids;
+	size_t n = json::path("list[*].id").each(o, [&ids](const json::value& u) { ids.push_back(&u); return true; });
+	assert (n == 2 && *ids[0] == 1.0 && *ids[1] == 2.0);
+	assert (json::path("a.b.*").each(o, [](const json::value&) { return true; }) == 4);
+	assert (json::path("list.*.id").each(o, [](const json::value&) { return false; }) == 1);
+
+	// found values can be changed in place
+	*json::path("/a/b/0").find(v) = json::value(11.0);
+	assert (*json::path("a.b[0]").find(o) == 11.0);
+}
+
+void test_lazy(void)
+{
+	const char doc[] = " {\"id\": 42, \"name\": \"x\\\"y\", \"skip\": {\"deep\": [1, [2, {\"k\": \"]}\"}]]},"
+		" \"list\": [true, false, null, -1.5e2, \"s\"], \"e\\u0073c\": 7, \"o\": {\"a\": {\"b\": \"c\"}}} ";
+	json::parse::document d(doc, sizeof(doc) - 1);
+	assert (!d.error());
+	json::parse::lazy r = d.root();
+	assert (r.type() == JSON_OBJECT);
+
+	double id;
+	assert (r["id"].get(id) && id == 42);
+	std::string name;
+	assert (r["name"].get(name) && name == "x\"y");
+	assert (!r["missing"] && r["missing"].type() == JSON_UNDEFINED);
+	assert (r["esc"] && r["esc"].get(id) && id == 7);
+
+	// brackets inside strings do not confuse skipping
+	assert (r["skip"]["deep"][1][1]["k"].raw() == string_(4, "\"]}\""));
+
+	json::parse::lazy l = r["list"];
+	bool b;
+	assert (l[0].get(b) && b && l[1].get(b) && !b);
+	assert (l[2].type() == JSON_NULL && l[3].get(id) && id == -150);
+	assert (!l[5] && !l[0].get(name));
+	size_t n = 0;
+	for (json::parse::lazy::iterator i = l.begin(); i != l.end(); ++i)
+		++n;
+	assert (n == 5);
+
+	// members in order
+	const char* keys[] = { "id", "name", "skip", "list", "e\\u0073c", "o" };
+	n = 0;
+	for (json::parse::lazy::iterator i = r.begin(); i != r.end(); ++i, ++n)
+		assert (i->key == string_(strlen(keys[n]), keys[n]) && i->escaped == (n == 4));
+	assert (n == 6);
+
+	// subtrees become values
+	json::value o = r["o"].value();
+	assert (o.type == JSON_OBJECT && (*(*o.data.object)["a"].data.object)["b"] == "c");
+	json::value all = r.value();
+	assert (json::to_string(all) == json::to_string(json::parse::read_value(doc, sizeof(doc) - 1)));
+
+	// broken structure is found up front, other errors when read
+	const char* bad[] = { "{\"a\": [1, 2}", "{\"a\": \"open}", "]", "{\"a\": 1}}", "{\"a\":x\",\"b\":[1]}\"}" };
+	for (size_t i = 0; i < sizeof(bad)/sizeof(*bad); ++i) {
+		assert (!d.read(bad[i], strlen(bad[i])) && d.error() && !d.root());
+	}
+	const char odd[] = "{\"a\": tru, \"b\": 1x, \"c\" 2, \"d\": trux, \"e\": fals3}";
+	assert (d.read(odd, sizeof(odd) - 1));
+	assert (!d.root()["a"].get(b) && !d.root()["b"].get(id) && !d.root()["c"]);
+	assert (!d.root()["d"].get(b) && !d.root()["e"].get(b));
+}
+
+int main()
+{
+	test_parse_buffer();
+	test_parse_long();
+	test_arena();
+	test_push_back();
+	test_flat_map();
+	test_view();
+	test_stream();
+	test_number();
+	test_inline();
+	test_move();
+	test_ndjson();
+	test_writer();
+	test_fields();
+	test_alloc();
+	test_memory();
+	test_path();
+	test_lazy();
+
+	return 0;
+}
@@ -1,47 +1,32 @@
 // debug.cpp - dump memory leaks
 // Copyright (c) 2006 KALX, LLC. All rights reserved. No warranty is made.
-#ifdef _DEBUG
-#define _CRTDBG_MAP_ALLOC
-#include <stdlib.h>
-#include <crtdbg.h>
+// reports memory still held by json values at exit, see json::alloc_stats
+#if !defined(NDEBUG) && !defined(JSON_NO_ALLOC_STATS)
+#include <cstdio>
+#include "../json/json.h"
 
-struct CrtDbg {
-	CrtDbg(int flags = _CRTDBG_ALLOC_MEM_DF)
+struct leak_check {
+	~leak_check()
 	{
-		_CrtSetDbgFlag (_CrtSetDbgFlag( _CRTDBG_REPORT_FLAG )|flags);
-//		_crtBreakAlloc = 2730; // {2723} normal block at 0xX, y bytes long.
-	}
-	// When information about a memory block is reported by one of the debug 
-	// dump functions, this number is enclosed in braces, such as {36}.
-	// Alternatively, set _crtBreakAlloc in the debugger.
-	static long SetBreakAlloc(long breakAlloc)
-	{
-		return breakAlloc ? _CrtSetBreakAlloc(breakAlloc) : 0;
-	}
-	// Verifies that a specified memory block is in the local heap and that it 
-	// has a valid debug heap block type identifier. Any of the last three
-	// arguments may be NULL.
-	static int IsMemoryBlock(const void* userData, unsigned int size,
-		long* requestNumber, char** filename, int* linenumber)
-	{
-		return _CrtIsMemoryBlock(userData, size, requestNumber, filename, linenumber);
-	}
-	static long RequestNumber(const void* userData, unsigned int size)
-	{
-		long req;
+		json::alloc_stats s = json::total_alloc_stats();
 
-		return IsMemoryBlock(userData, size, &req, 0, 0) ? req : 0;
-	}
-	~CrtDbg()
-	{
-		if (!(_CrtSetDbgFlag( _CRTDBG_REPORT_FLAG )&_CRTDBG_LEAK_CHECK_DF))
-			_CrtDumpMemoryLeaks();
+		if (s.live)
+			fprintf(stderr, "json: %lld bytes in %lld blocks not freed, peak %lld bytes\n",
+				static_cast<long long>(s.live),
+				static_cast<long long>(s.allocations - s.frees),
+				static_cast<long long>(s.peak));
 	}
 };
 
-// need to construct this before user segment
+// construct this before other statics so it is destroyed after them
+#if defined(_MSC_VER)
 #pragma warning(disable: 4073)
 #pragma init_seg(lib)
-CrtDbg crtDbg;
+leak_check leak_check_;
+#elif defined(__GNUC__)
+leak_check leak_check_ __attribute__((init_priority(101)));
+#else
+leak_check leak_check_;
+#endif
 
-#endif // _DEBUG
+#endif // !NDEBUG && !JSON_NO_ALLOC_STATS